@@ -1,10 +1,72 @@
 #include "alt_ukf.h"
 #include "nav_ukf.h"
 #include "imu.h"
+#include "health.h"
 #include <string.h>
 
 altUkfStruct_t altUkfData;
 
+// closed form Kalman filter over the same model as the UKF below:
+//   vel' = vel + (acc + bias)*dt
+//   pos' = pos - vel'*dt - (acc + bias)*dt^2/2
+// the model is linear so the UKF's sigma points buy nothing here
+// same order as altUkfTimeUpdate(), which updates in place so the position
+// step sees the new velocity
+static void altKfTimeUpdate(float acc, float dt) {
+    float *x = altUkfData.kfX;
+    float *P = altUkfData.kfP;
+    float h = dt * dt * 0.5f;
+    float b = dt * dt + h;      // d pos / d bias
+    float q;
+    float a;
+    int i;
+
+    a = acc + x[ALT_STATE_BIAS];
+    x[ALT_STATE_VEL] += a * dt;
+    x[ALT_STATE_POS] -= x[ALT_STATE_VEL] * dt + a * h;
+
+    // P = F * P * F', F is upper triangular so rows/cols can be updated in place
+    for (i = 0; i < ALT_S; i++) {
+        P[ALT_STATE_POS*ALT_S + i] -= P[ALT_STATE_VEL*ALT_S + i] * dt + P[ALT_STATE_BIAS*ALT_S + i] * b;
+        P[ALT_STATE_VEL*ALT_S + i] += P[ALT_STATE_BIAS*ALT_S + i] * dt;
+    }
+    for (i = 0; i < ALT_S; i++) {
+        P[i*ALT_S + ALT_STATE_POS] -= P[i*ALT_S + ALT_STATE_VEL] * dt + P[i*ALT_S + ALT_STATE_BIAS] * b;
+        P[i*ALT_S + ALT_STATE_VEL] += P[i*ALT_S + ALT_STATE_BIAS] * dt;
+    }
+
+    // velocity noise reaches the position through the updated velocity
+    q = ALT_VEL_NOISE * dt * dt;
+    P[ALT_STATE_VEL*ALT_S + ALT_STATE_VEL] += q;
+    P[ALT_STATE_POS*ALT_S + ALT_STATE_VEL] -= q * dt;
+    P[ALT_STATE_VEL*ALT_S + ALT_STATE_POS] -= q * dt;
+    P[ALT_STATE_POS*ALT_S + ALT_STATE_POS] += q * dt * dt;
+    P[ALT_STATE_BIAS*ALT_S + ALT_STATE_BIAS] += ALT_BIAS_NOISE * dt * dt;
+}
+
+static void altKfPresUpdate(float alt) {
+    float *x = altUkfData.kfX;
+    float *P = altUkfData.kfP;
+    float p0[ALT_S];
+    float e, s;
+    int i, j;
+
+    // H = [1 0 0]
+    s = 1.0f / (P[ALT_STATE_POS*ALT_S + ALT_STATE_POS] + ALT_PRES_NOISE);
+    e = alt - x[ALT_STATE_POS];
+
+    for (i = 0; i < ALT_S; i++)
+        p0[i] = P[ALT_STATE_POS*ALT_S + i];
+
+    for (i = 0; i < ALT_S; i++) {
+        x[i] += p0[i] * s * e;
+
+        for (j = 0; j < ALT_S; j++)
+            P[i*ALT_S + j] -= p0[i] * p0[j] * s;
+    }
+}
+
+#ifndef ALT_USE_KF
 void altUkfTimeUpdate(float *in, float *noise, float *out, float *u, float dt, int n) {
     float acc;
     int i;
@@ -25,53 +87,71 @@ void altUkfPresUpdate(float *u, float *x, float *noise, float *y) {
     y[0] = x[ALT_STATE_POS] + noise[0];     // return altitude
 }
 
-static void altDoPresUpdate(float measuredPres) {
+static void altDoPresUpdate(float alt) {
     float noise;        // measurement variance
     float y;            // measurment
 
     noise = ALT_PRES_NOISE;
-    y = navUkfPresToAlt(measuredPres);
+    y = alt;
 
     srcdkfMeasurementUpdate(altUkfData.kf, 0, &y, 1, 1, &noise, altUkfPresUpdate);
 }
 
+#endif
+
 void altUkfProcess(float measuredPres) {
-    float accIn[3];
-    float acc[3];
+    float *dcm = UKF_ATT.dcm;
+    float acc, alt;
 
-    accIn[0] = IMU_ACCX;// + UKF_ACC_BIAS_X;
-    accIn[1] = IMU_ACCY;// + UKF_ACC_BIAS_Y;
-    accIn[2] = IMU_ACCZ;// + UKF_ACC_BIAS_Z;
+    // only the down component of the world frame acc is needed, which is
+    // the last row of the nav filter's freshly published attitude matrix
+    acc = dcm[2*3 + 0] * IMU_ACCX + dcm[2*3 + 1] * IMU_ACCY + dcm[2*3 + 2] * IMU_ACCZ + GRAVITY;
+    alt = navUkfPresToAlt(measuredPres);
 
-    // rotate acc to world frame
-    navUkfRotateVectorByQuat(acc, accIn, &UKF_Q1);
-    acc[2] += GRAVITY;
+    altKfTimeUpdate(acc, AQ_OUTER_TIMESTEP);
+    if (HEALTH_GOOD(HEALTH_PRES))
+        altKfPresUpdate(alt);
 
-    srcdkfTimeUpdate(altUkfData.kf, &acc[2], AQ_OUTER_TIMESTEP);
+#ifndef ALT_USE_KF
+    srcdkfTimeUpdate(altUkfData.kf, &acc, AQ_OUTER_TIMESTEP);
 
-    altDoPresUpdate(measuredPres);
+    if (HEALTH_GOOD(HEALTH_PRES))
+        altDoPresUpdate(alt);
+#endif
 }
 
 void altUkfInit(void) {
     float Q[ALT_S];  // state variance
+#ifndef ALT_USE_KF
     float V[ALT_V];  // process variance
+#endif
+    int i;
 
     memset((void *)&altUkfData, 0, sizeof(altUkfData));
 
-    altUkfData.kf = srcdkfInit(ALT_S, ALT_M, ALT_V, ALT_N, altUkfTimeUpdate);
-
-    altUkfData.x = srcdkfGetState(altUkfData.kf);
-
     Q[ALT_STATE_POS] = 5.0f;
     Q[ALT_STATE_VEL] = 1e-6f;
     Q[ALT_STATE_BIAS] = 0.05f;
 
+    for (i = 0; i < ALT_S; i++)
+        altUkfData.kfP[i*ALT_S + i] = Q[i];
+
+    ALT_KF_POS = navUkfPresToAlt(AQ_PRESSURE);
+    ALT_KF_VEL = 0.0f;
+    ALT_KF_BIAS = 0.0f;
+
+#ifndef ALT_USE_KF
+    altUkfData.kf = srcdkfInit(ALT_S, ALT_M, ALT_V, ALT_N, altUkfTimeUpdate);
+
+    altUkfData.x = srcdkfGetState(altUkfData.kf);
+
     V[ALT_NOISE_BIAS] = ALT_BIAS_NOISE;
     V[ALT_NOISE_VEL] = ALT_VEL_NOISE;
 
     srcdkfSetVariance(altUkfData.kf, Q, V, 0, 0);
 
-    ALT_POS = navUkfPresToAlt(AQ_PRESSURE);
+    ALT_POS = ALT_KF_POS;
     ALT_VEL = 0.0f;
     ALT_BIAS = 0.0f;
+#endif
 }
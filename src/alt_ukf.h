@@ -1,6 +1,7 @@
 #ifndef _alt_ukf_h
 #define _alt_ukf_h
 
+#include "aq.h"
 #include "srcdkf.h"
 
 #define ALT_S           3   // states
@@ -15,17 +16,32 @@
 #define ALT_NOISE_BIAS  0
 #define ALT_NOISE_VEL   1
 
+// closed form filter, always run so it can be compared against the UKF in logs
+#define ALT_KF_POS      altUkfData.kfX[ALT_STATE_POS]
+#define ALT_KF_VEL      altUkfData.kfX[ALT_STATE_VEL]
+#define ALT_KF_BIAS     altUkfData.kfX[ALT_STATE_BIAS]
+
+#ifdef ALT_USE_KF
+#define ALT_POS         ALT_KF_POS
+#define ALT_VEL         ALT_KF_VEL
+#define ALT_BIAS        ALT_KF_BIAS
+#else
 #define ALT_POS         altUkfData.x[ALT_STATE_POS]
 #define ALT_VEL         altUkfData.x[ALT_STATE_VEL]
 #define ALT_BIAS        altUkfData.x[ALT_STATE_BIAS]
+#endif
 
 #define ALT_PRES_NOISE  0.02f
 #define ALT_BIAS_NOISE  5e-4f//5e-5f
 #define ALT_VEL_NOISE   5e-4f
 
 typedef struct {
+#ifndef ALT_USE_KF
     srcdkf_t *kf;
     float *x;               // states
+#endif
+    float kfX[ALT_S];       // closed form filter states
+    float kfP[ALT_S*ALT_S]; // closed form filter covariance
 } altUkfStruct_t;
 
 extern altUkfStruct_t altUkfData;
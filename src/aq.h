@@ -26,6 +26,9 @@
 
 #define USE_MAVLINK
 #define USE_PRES_ALT        // uncomment to use pressure altitude instead of GPS
+//#define ALT_USE_KF        // uncomment to replace the altitude UKF with the closed form altitude Kalman filter
+//#define DIMU_INNER_PERIOD 1000 // uncomment to run the digital IMU rate loop faster than 400Hz (us, must divide 5000)
+//#define DIMU_INNER_SYNC   // uncomment to clock the rate loop from MPU6000 reads instead of the DIMU timer
 #define USE_SIGNALING       // uncomment to use external signaling events and ports
 //#define HAS_QUATOS        // build including Quatos library
 //#define HAS_AQ_TELEMETRY  // uncomment to include AQ native binary telemetry and command interface
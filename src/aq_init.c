@@ -33,11 +33,13 @@
 #include "logger.h"
 #include "alt_ukf.h"
 #include "nav_ukf.h"
+#include "vibe.h"
 #include "aq_mavlink.h"
 #include "util.h"
 #include "supervisor.h"
 #include "gimbal.h"
 #include "run.h"
+#include "health.h"
 #include "sdio.h"
 #include "can.h"
 #include "analog.h"
@@ -85,6 +87,8 @@ void aqInit(void *pdata) {
     altUkfInit();
     radioInit();
     gpsInit();
+    navUkfWmmInit();
+    vibeInit();
     navInit();
 #ifdef HAS_AQ_TELEMETRY
     commandInit();
@@ -101,6 +105,7 @@ void aqInit(void *pdata) {
     motorsInit();
     controlInit();
     gimbalInit();
+    healthInit();
     runInit();
 
     info();
@@ -31,7 +31,9 @@
 #include "flash.h"
 #include "gimbal.h"
 #include "gps.h"
+#include "health.h"
 #include "imu.h"
+#include "logger.h"
 #include "motors.h"
 #include "nav.h"
 #include "nav_ukf.h"
@@ -42,6 +44,7 @@
 #include "run.h"
 #include "supervisor.h"
 #include "util.h"
+#include "vibe.h"
 
 #include <CoOS.h>
 #include <math.h>
@@ -65,6 +68,7 @@ void mavlinkSendPacket(mavlink_channel_t chan, const uint8_t *buf, uint16_t len)
             *ptr++ = *buf++;
 
         commSendTxBuf(txBuf, len);
+        mavlinkData.txBytes += len;
     }
 }
 
@@ -132,9 +136,232 @@ static void mavlinkSendParamValue(uint16_t id, uint16_t ttl, bool raw) {
     mavlink_system.compid = AQMAVLINK_DEFAULT_COMP_ID;
 }
 
+static void mavlinkBulkSendHandshake(uint16_t packets, uint32_t size) {
+    mavlink_system.compid = mavlinkData.paramCompId;
+    mavlink_msg_data_transmission_handshake_send(MAVLINK_COMM_0, mavlinkData.bulkType, size, mavlinkData.bulkCrc, CONFIG_NUM_PARAMS, packets, AQMAVLINK_BULK_CHUNK, 0);
+    mavlink_system.compid = AQMAVLINK_DEFAULT_COMP_ID;
+}
+
+// snapshot all params into the bulk blob and start sending it unless the GCS already has it
+static void mavlinkBulkRead(uint16_t gcsCrc) {
+    uint16_t *hdr = (uint16_t *)mavlinkData.bulkBuf;
+    float *vals = (float *)(mavlinkData.bulkBuf + 2*sizeof(uint16_t));
+    int i;
+
+    hdr[0] = CONFIG_CURRENT_VERSION;
+    hdr[1] = CONFIG_NUM_PARAMS;
+    for (i = 0; i < CONFIG_NUM_PARAMS; i++)
+        vals[i] = configGetParamValueForSave(i);
+
+    mavlinkData.bulkType = AQMAVLINK_BULK_PARAM_READ;
+    mavlinkData.bulkCrc = crc_calculate(mavlinkData.bulkBuf, AQMAVLINK_BULK_SIZE);
+
+    if (mavlinkData.bulkCrc == gcsCrc) {
+        mavlinkBulkSendHandshake(0, AQMAVLINK_BULK_SIZE);
+        mavlinkData.bulkType = 0;
+    }
+    else {
+        mavlinkBulkSendHandshake(AQMAVLINK_BULK_PACKETS, AQMAVLINK_BULK_SIZE);
+        mavlinkData.bulkSeq = 0;
+        mavlinkData.nextBulk = 0;
+    }
+}
+
+// apply a completely received blob, answer with the number of params accepted
+static void mavlinkBulkWrite(void) {
+    uint16_t *hdr = (uint16_t *)mavlinkData.bulkBuf;
+    float *vals = (float *)(mavlinkData.bulkBuf + 2*sizeof(uint16_t));
+    uint16_t n = 0;
+    int i;
+
+    if (crc_calculate(mavlinkData.bulkBuf, AQMAVLINK_BULK_SIZE) != mavlinkData.bulkCrc)
+        AQ_NOTICE("Error: Bulk params CRC mismatch.");
+    else if (hdr[0] != CONFIG_CURRENT_VERSION || hdr[1] != CONFIG_NUM_PARAMS)
+        AQ_NOTICE("Error: Bulk params version mismatch.");
+    else if (supervisorData.state & STATE_FLYING)
+        AQ_NOTICE("Error: Can't set parameters while flying!");
+    else {
+        for (i = 0; i < CONFIG_NUM_PARAMS; i++)
+            if (configSetParamByID(i, vals[i]))
+                n++;
+
+        AQ_PRINTF("%u params set from bulk transfer.", n);
+    }
+
+    mavlinkBulkSendHandshake(AQMAVLINK_BULK_PACKETS, n);
+    mavlinkData.bulkType = 0;
+}
+
+static uint8_t mavlinkLogInit(void) {
+    if (!mavlinkData.logBuf) {
+        mavlinkData.logHandle = filerGetHandle(AQMAVLINK_LOG_FNAME);
+        if (mavlinkData.logHandle < 0)
+            return 0;
+
+        mavlinkData.logList = (filerLogEntry_t *)aqDataCalloc(FILER_MAX_LOGS, sizeof(filerLogEntry_t));
+        // SDIO DMA cannot reach CCM
+        mavlinkData.logBuf = (uint8_t *)aqCalloc(2, AQMAVLINK_LOG_BUF);
+    }
+
+    return (mavlinkData.logBuf != 0);
+}
+
+// which read-ahead buffer holds this file offset
+static int8_t mavlinkLogSlot(uint32_t ofs) {
+    int i;
+
+    for (i = 0; i < 2; i++)
+        if (mavlinkData.logBufLen[i] > 0 && ofs >= mavlinkData.logBufOfs[i] && ofs < mavlinkData.logBufOfs[i] + mavlinkData.logBufLen[i])
+            return i;
+
+    return -1;
+}
+
+static void mavlinkLogFetch(uint8_t slot, uint32_t ofs) {
+    if (filerReadAsync(mavlinkData.logHandle, mavlinkData.logBuf + slot*AQMAVLINK_LOG_BUF, ofs, AQMAVLINK_LOG_BUF) == FILER_STATUS_OK) {
+        mavlinkData.logBufOfs[slot] = ofs;
+        mavlinkData.logBufLen[slot] = FILER_STATUS_BUSY;
+    }
+}
+
+// send LOG_DATA while tx buffers are available, keep the filer reading ahead
+static void mavlinkLogService(void) {
+    mavlink_message_t msg;
+    uint8_t pkt[MAVLINK_MAX_PACKET_LEN];
+    uint8_t data[AQMAVLINK_LOG_DATA];
+    commTxBuf_t *txBuf;
+    uint32_t blk, len;
+    uint16_t pktLen;
+    int32_t ret;
+    int8_t s;
+    int i;
+
+    // collect finished read
+    for (i = 0; i < 2; i++) {
+        if (mavlinkData.logBufLen[i] == FILER_STATUS_BUSY && (ret = filerPoll(mavlinkData.logHandle)) != FILER_STATUS_BUSY) {
+            mavlinkData.logBufLen[i] = ret;
+
+            if (ret < 0) {
+                AQ_PRINTF("Error: Log read failed [%d]", ret);
+                mavlinkData.logBufLen[i] = 0;
+                mavlinkData.logEnd = mavlinkData.logOfs;
+            }
+            // file is shorter than listed
+            else if (ret == 0 && mavlinkData.logBufOfs[i] <= mavlinkData.logOfs) {
+                mavlinkData.logEnd = mavlinkData.logOfs;
+            }
+        }
+    }
+
+    for (i = 0; i < AQMAVLINK_LOG_BURST && mavlinkData.logOfs < mavlinkData.logEnd; i++) {
+        if ((s = mavlinkLogSlot(mavlinkData.logOfs)) < 0)
+            break;
+
+        len = mavlinkData.logBufOfs[s] + mavlinkData.logBufLen[s] - mavlinkData.logOfs;
+        if (len > mavlinkData.logEnd - mavlinkData.logOfs)
+            len = mavlinkData.logEnd - mavlinkData.logOfs;
+        if (len > AQMAVLINK_LOG_DATA)
+            len = AQMAVLINK_LOG_DATA;
+
+        memset(data, 0, sizeof(data));
+        memcpy(data, mavlinkData.logBuf + s*AQMAVLINK_LOG_BUF + (mavlinkData.logOfs - mavlinkData.logBufOfs[s]), len);
+
+        mavlink_msg_log_data_pack(mavlink_system.sysid, mavlink_system.compid, &msg, mavlinkData.logId, mavlinkData.logOfs, len, data);
+        pktLen = mavlink_msg_to_send_buffer(pkt, &msg);
+
+        // flow control, try again next time
+        if ((txBuf = commGetTxBuf(COMM_STREAM_TYPE_MAVLINK, pktLen)) == 0)
+            break;
+
+        memcpy(&txBuf->buf, pkt, pktLen);
+        commSendTxBuf(txBuf, pktLen);
+        mavlinkData.txBytes += pktLen;
+
+        mavlinkData.logOfs += len;
+    }
+
+    // keep the current and the next block in the read-ahead buffers
+    if (mavlinkData.logOfs < mavlinkData.logEnd && mavlinkData.logBufLen[0] != FILER_STATUS_BUSY && mavlinkData.logBufLen[1] != FILER_STATUS_BUSY) {
+        blk = mavlinkData.logOfs & ~(AQMAVLINK_LOG_BUF-1);
+
+        if ((s = mavlinkLogSlot(mavlinkData.logOfs)) < 0)
+            mavlinkLogFetch((mavlinkLogSlot(blk + AQMAVLINK_LOG_BUF) == 0) ? 1 : 0, blk);
+        else if (blk + AQMAVLINK_LOG_BUF < mavlinkData.logEnd && mavlinkLogSlot(blk + AQMAVLINK_LOG_BUF) < 0)
+            mavlinkLogFetch(s ^ 1, blk + AQMAVLINK_LOG_BUF);
+    }
+}
+
+// collect the directory scan started by LOG_REQUEST_LIST
+static void mavlinkLogListPoll(void) {
+    int32_t n;
+
+    if ((n = filerPoll(mavlinkData.logHandle)) == FILER_STATUS_BUSY)
+        return;
+
+    mavlinkData.logListing = 0;
+    mavlinkData.logCount = (n > 0) ? n : 0;
+
+    if (mavlinkData.logCount == 0) {
+        mavlink_msg_log_entry_send(MAVLINK_COMM_0, 0, 0, 0, 0, 0);
+    }
+    else {
+        mavlinkData.logListNext = (mavlinkData.logListStart > 0) ? mavlinkData.logListStart : 1;
+        mavlinkData.logListEnd = (mavlinkData.logListStop < mavlinkData.logCount) ? mavlinkData.logListStop : mavlinkData.logCount;
+    }
+}
+
+static void mavlinkLogRequestData(uint16_t id, uint32_t ofs, uint32_t count) {
+    uint8_t data[AQMAVLINK_LOG_DATA];
+    char fname[16];
+    uint32_t size;
+
+    if (id < 1 || id > mavlinkData.logCount)
+        return;
+
+    if (supervisorData.state & STATE_ARMED) {
+        AQ_NOTICE("Error: Can't download logs while armed!");
+        return;
+    }
+
+    if (id != mavlinkData.logId) {
+        sprintf(fname, "%03d-%s.LOG", mavlinkData.logList[id-1].session, LOGGER_FNAME);
+        filerSetFileName(mavlinkData.logHandle, fname);
+        mavlinkData.logBufLen[0] = mavlinkData.logBufLen[1] = 0;
+        mavlinkData.logId = id;
+    }
+
+    size = mavlinkData.logList[id-1].size;
+    if (ofs > size)
+        ofs = size;
+    if (count > size - ofs)
+        count = size - ofs;
+
+    mavlinkData.logOfs = ofs;
+    mavlinkData.logEnd = ofs + count;
+
+    // nothing left, tell the GCS
+    if (count == 0) {
+        memset(data, 0, sizeof(data));
+        mavlink_msg_log_data_send(MAVLINK_COMM_0, id, ofs, 0, data);
+    }
+}
+
+static void mavlinkLogRequestEnd(void) {
+    mavlinkData.logOfs = mavlinkData.logEnd = 0;
+    mavlinkData.logListNext = mavlinkData.logListEnd = 0;
+
+    if (mavlinkData.logId) {
+        filerSetFileName(mavlinkData.logHandle, AQMAVLINK_LOG_FNAME);
+        mavlinkData.logBufLen[0] = mavlinkData.logBufLen[1] = 0;
+        mavlinkData.logId = 0;
+    }
+}
+
 static void mavlinkToggleStreams(uint8_t enable) {
-    for (uint8_t i = 0; i < AQMAVLINK_TOTAL_STREAMS; i++)
+    for (uint8_t i = 0; i < AQMAVLINK_TOTAL_STREAMS; i++) {
         mavlinkData.streams[i].enable = enable && mavlinkData.streams[i].interval;
+        mavlinkData.streams[i].next = 0;
+    }
 }
 
 static void mavlinkSetSystemData(void) {
@@ -169,57 +396,65 @@ static void mavlinkSetSystemData(void) {
 
 }
 
-void mavlinkDo(void) {
-    static unsigned long lastMicros = 0;
-    unsigned long micros;
-    int8_t streamAll;
-    int8_t currDraw = -1;
-
-    micros = timerMicros();
-
-    // handle rollover
-    if (micros < lastMicros) {
-        mavlinkData.nextHeartbeat = 0;
-        mavlinkData.nextParam = 0;
-        mavlinkData.nextWP = 0;
-        for (uint8_t i=0; i < AQMAVLINK_TOTAL_STREAMS; ++i)
-            mavlinkData.streams[i].next = 0;
-    }
+// SYS_STATUS sensor bits for each health monitor channel, CAN sensors have none
+static const uint32_t mavlinkHealthSensors[HEALTH_NUM] = {
+    MAV_SYS_STATUS_SENSOR_3D_GYRO,
+    MAV_SYS_STATUS_SENSOR_3D_ACCEL,
+    MAV_SYS_STATUS_SENSOR_3D_MAG,
+    MAV_SYS_STATUS_SENSOR_ABSOLUTE_PRESSURE,
+    MAV_SYS_STATUS_SENSOR_GPS,
+    0
+};
+
+static void mavlinkSensorStatus(uint32_t *present, uint32_t *healthy) {
+    int i;
 
-    supervisorSendDataStart();
+    *present = 0;
+    *healthy = 0;
 
-    // heartbeat
-    if (mavlinkData.nextHeartbeat < micros) {
-        mavlinkSetSystemData();
-        mavlink_msg_heartbeat_send(MAVLINK_COMM_0, mavlinkData.sys_type, MAV_AUTOPILOT_AUTOQUAD, mavlinkData.sys_mode, supervisorData.systemStatus, mavlinkData.sys_state);
-        mavlinkData.nextHeartbeat = micros + AQMAVLINK_HEARTBEAT_INTERVAL;
+    for (i = 0; i < HEALTH_NUM; i++) {
+        if (healthData.chan[i].present) {
+            *present |= mavlinkHealthSensors[i];
+            if (HEALTH_GOOD(i))
+                *healthy |= mavlinkHealthSensors[i];
+        }
     }
+}
 
-    // send streams
-
-    // first check if "ALL" stream is requested
-    if ((streamAll = mavlinkData.streams[MAV_DATA_STREAM_ALL].enable && mavlinkData.streams[MAV_DATA_STREAM_ALL].next < micros))
-        mavlinkData.streams[MAV_DATA_STREAM_ALL].next = micros + mavlinkData.streams[MAV_DATA_STREAM_ALL].interval;
-
+// send one telemetry stream
+static void mavlinkSendStream(uint8_t stream, unsigned long micros) {
+    switch (stream) {
     // status
-    if (streamAll || (mavlinkData.streams[MAV_DATA_STREAM_EXTENDED_STATUS].enable && mavlinkData.streams[MAV_DATA_STREAM_EXTENDED_STATUS].next < micros)) {
-        currDraw = (supervisorData.aOutLPF == SUPERVISOR_INVALID_AMPSOUT_VALUE) ? -1 : supervisorData.aOutLPF * 100;
+    case MAV_DATA_STREAM_EXTENDED_STATUS :
+    {
+        int8_t currDraw = (supervisorData.aOutLPF == SUPERVISOR_INVALID_AMPSOUT_VALUE) ? -1 : supervisorData.aOutLPF * 100;
+        uint32_t present, healthy;
 
-        mavlink_msg_sys_status_send(MAVLINK_COMM_0, 0, 0, 0, (uint16_t)(1000L - LROUNDF(supervisorData.idlePercent * 10.0f)), supervisorData.vInLPF * 1000, currDraw,
+        mavlinkSensorStatus(&present, &healthy);
+
+        mavlink_msg_sys_status_send(MAVLINK_COMM_0, present, present, healthy, (uint16_t)(1000L - LROUNDF(supervisorData.idlePercent * 10.0f)), supervisorData.vInLPF * 1000, currDraw,
                 supervisorData.battRemainingPrct, 0, mavlinkData.packetDrops, 0, 0, 0, 0);
         mavlink_msg_radio_status_send(MAVLINK_COMM_0, RADIO_QUALITY, 0, 0, 0, 0, RADIO_ERROR_COUNT, 0);
 
-        mavlinkData.streams[MAV_DATA_STREAM_EXTENDED_STATUS].next = micros + mavlinkData.streams[MAV_DATA_STREAM_EXTENDED_STATUS].interval;
+        break;
     }
     // raw sensors
-    if (streamAll || (mavlinkData.streams[MAV_DATA_STREAM_RAW_SENSORS].enable && mavlinkData.streams[MAV_DATA_STREAM_RAW_SENSORS].next < micros)) {
-        mavlink_msg_scaled_imu_send(MAVLINK_COMM_0, micros, IMU_ACCX*1000.0f, IMU_ACCY*1000.0f, IMU_ACCZ*1000.0f, IMU_RATEX*1000.0f, IMU_RATEY*1000.0f, IMU_RATEZ*1000.0f,
-                IMU_MAGX*1000.0f, IMU_MAGY*1000.0f, IMU_MAGZ*1000.0f);
-        mavlink_msg_scaled_pressure_send(MAVLINK_COMM_0, micros, AQ_PRESSURE*0.01f, 0.0f, IMU_TEMP*100);
-        mavlinkData.streams[MAV_DATA_STREAM_RAW_SENSORS].next = micros + mavlinkData.streams[MAV_DATA_STREAM_RAW_SENSORS].interval;
+    case MAV_DATA_STREAM_RAW_SENSORS :
+    {
+        imuSample_t imu;
+
+        imuGetSample(&imu);
+        mavlink_msg_scaled_imu_send(MAVLINK_COMM_0, micros, imu.acc[0]*1000.0f, imu.acc[1]*1000.0f, imu.acc[2]*1000.0f, imu.rate[0]*1000.0f, imu.rate[1]*1000.0f, imu.rate[2]*1000.0f,
+                imu.mag[0]*1000.0f, imu.mag[1]*1000.0f, imu.mag[2]*1000.0f);
+        mavlink_msg_scaled_pressure_send(MAVLINK_COMM_0, micros, imu.pressure*0.01f, 0.0f, imu.temp*100);
+        break;
     }
     // position -- gps and ukf
-    if (streamAll || (mavlinkData.streams[MAV_DATA_STREAM_POSITION].enable && mavlinkData.streams[MAV_DATA_STREAM_POSITION].next < micros)) {
+    case MAV_DATA_STREAM_POSITION :
+    {
+        navUkfOutput_t ukf;
+
+        navUkfGetOutput(&ukf);
 #ifdef MAVLINK_V2
         mavlink_msg_gps_raw_int_send(MAVLINK_COMM_0, micros, navData.fixType,
                 gpsData.lat*(double)1e7, gpsData.lon*(double)1e7, gpsData.height*1e3,
@@ -229,11 +464,12 @@ void mavlinkDo(void) {
         mavlink_msg_gps_raw_int_send(MAVLINK_COMM_0, micros, navData.fixType, gpsData.lat*(double)1e7, gpsData.lon*(double)1e7, gpsData.height*1e3,
                 gpsData.hAcc*100, gpsData.vAcc*100, gpsData.speed*100, gpsData.heading, gpsData.noSV);
 #endif
-        mavlink_msg_local_position_ned_send(MAVLINK_COMM_0, micros, UKF_POSN, UKF_POSE, ALTITUDE, UKF_VELN, UKF_VELE, -VELOCITYD);
-        mavlinkData.streams[MAV_DATA_STREAM_POSITION].next = micros + mavlinkData.streams[MAV_DATA_STREAM_POSITION].interval;
+        mavlink_msg_local_position_ned_send(MAVLINK_COMM_0, micros, ukf.x[UKF_STATE_POSN], ukf.x[UKF_STATE_POSE], ALTITUDE, ukf.x[UKF_STATE_VELN], ukf.x[UKF_STATE_VELE], -VELOCITYD);
+        break;
     }
     // radio channels
-    if (streamAll || (mavlinkData.streams[MAV_DATA_STREAM_RC_CHANNELS].enable && mavlinkData.streams[MAV_DATA_STREAM_RC_CHANNELS].next < micros)) {
+    case MAV_DATA_STREAM_RC_CHANNELS :
+    {
         int16_t *rc;
         mavlinkData.indexPort++;
         if (radioData.mode == RADIO_MODE_SPLIT) {
@@ -247,19 +483,28 @@ void mavlinkDo(void) {
         }
         uint8_t ci = mavlinkData.indexPort * 8;
         mavlink_msg_rc_channels_raw_send(MAVLINK_COMM_0, micros, mavlinkData.indexPort, rc[ci]+1024, rc[ci+1]+1024, rc[ci+2]+1024, rc[ci+3]+1024, rc[ci+4]+1024, rc[ci+5]+1024, rc[ci+6]+1024, rc[ci+7]+1024, RADIO_QUALITY);
-        mavlinkData.streams[MAV_DATA_STREAM_RC_CHANNELS].next = micros + mavlinkData.streams[MAV_DATA_STREAM_RC_CHANNELS].interval;
+        break;
     }
     // raw controller -- attitude and nav data
-    if (streamAll || (mavlinkData.streams[MAV_DATA_STREAM_RAW_CONTROLLER].enable && mavlinkData.streams[MAV_DATA_STREAM_RAW_CONTROLLER].next < micros)) {
-        mavlink_msg_attitude_send(MAVLINK_COMM_0, micros, AQ_ROLL*DEG_TO_RAD, AQ_PITCH*DEG_TO_RAD, AQ_YAW*DEG_TO_RAD, -(IMU_RATEX - UKF_GYO_BIAS_X)*DEG_TO_RAD,
-                (IMU_RATEY - UKF_GYO_BIAS_Y)*DEG_TO_RAD, (IMU_RATEZ - UKF_GYO_BIAS_Z)*DEG_TO_RAD);
+    case MAV_DATA_STREAM_RAW_CONTROLLER :
+    {
+        navUkfAttitude_t att;
+        navUkfOutput_t ukf;
+        imuSample_t imu;
+
+        navUkfGetAttitude(&att);
+        navUkfGetOutput(&ukf);
+        imuGetSample(&imu);
+        mavlink_msg_attitude_send(MAVLINK_COMM_0, micros, att.roll*DEG_TO_RAD, att.pitch*DEG_TO_RAD, att.yaw*DEG_TO_RAD, -(imu.rate[0] - ukf.x[UKF_STATE_GYO_BIAS_X])*DEG_TO_RAD,
+                (imu.rate[1] - ukf.x[UKF_STATE_GYO_BIAS_Y])*DEG_TO_RAD, (imu.rate[2] - ukf.x[UKF_STATE_GYO_BIAS_Z])*DEG_TO_RAD);
         mavlink_msg_nav_controller_output_send(MAVLINK_COMM_0, navData.holdTiltE, navData.holdTiltN, navData.holdHeading*100, navData.holdCourse*100, navData.holdDistance*100, navData.holdAlt, 0, 0);
 
-        mavlinkData.streams[MAV_DATA_STREAM_RAW_CONTROLLER].next = micros + mavlinkData.streams[MAV_DATA_STREAM_RAW_CONTROLLER].interval;
+        break;
     }
 #ifdef MAVLINK_MSG_ID_AQ_ESC_TELEMETRY
     // ESC/Motor telemetry
-    if (streamAll || (mavlinkData.streams[MAV_DATA_STREAM_PROPULSION].enable && mavlinkData.streams[MAV_DATA_STREAM_PROPULSION].next < micros)) {
+    case MAV_DATA_STREAM_PROPULSION :
+    {
         uint8_t id, i, m, s;
         uint8_t mId[4], dataVer[4];
         uint16_t statAge[4];
@@ -284,11 +529,12 @@ void mavlinkDo(void) {
                 m = 0;
             }
         }
-        mavlinkData.streams[MAV_DATA_STREAM_PROPULSION].next = micros + mavlinkData.streams[MAV_DATA_STREAM_PROPULSION].interval;
+        break;
     }
 #endif
     // EXTRA3 stream -- AQ custom telemetry
-    if (streamAll || (mavlinkData.streams[MAV_DATA_STREAM_EXTRA3].enable && mavlinkData.streams[MAV_DATA_STREAM_EXTRA3].next < micros)) {
+    case MAV_DATA_STREAM_EXTRA3 :
+    {
         for (uint8_t i=0; i < AQMAV_DATASET_ENUM_END; ++i) {
             if (!mavlinkData.customDatasets[i])
                 continue;
@@ -298,9 +544,16 @@ void mavlinkDo(void) {
                         micros - gpsData.lastPosUpdate, micros - gpsData.lastMessage, gpsData.vAcc, gpsData.lat, gpsData.lon, gpsData.hAcc, gpsData.heading, gpsData.height, gpsData.iTOW, 0,0,0,0);
                 break;
             case AQMAV_DATASET_UKF :
-                mavlink_msg_aq_telemetry_f_send(MAVLINK_COMM_0, i, UKF_GYO_BIAS_X, UKF_GYO_BIAS_Y, UKF_GYO_BIAS_Z, UKF_ACC_BIAS_X, UKF_ACC_BIAS_Y, UKF_ACC_BIAS_Z, UKF_Q1, UKF_Q2, UKF_Q3, UKF_Q4,
-                        UKF_ALTITUDE, UKF_POSN, UKF_POSE, UKF_POSD, UKF_VELN, UKF_VELE, UKF_VELD, UKF_PRES_ALT, ALT_POS, ALT_VEL);
+            {
+                navUkfOutput_t ukf;
+                float *x = ukf.x;
+
+                navUkfGetOutput(&ukf);
+                mavlink_msg_aq_telemetry_f_send(MAVLINK_COMM_0, i, x[UKF_STATE_GYO_BIAS_X], x[UKF_STATE_GYO_BIAS_Y], x[UKF_STATE_GYO_BIAS_Z], x[UKF_STATE_ACC_BIAS_X], x[UKF_STATE_ACC_BIAS_Y], x[UKF_STATE_ACC_BIAS_Z],
+                        x[UKF_STATE_Q1], x[UKF_STATE_Q2], x[UKF_STATE_Q3], x[UKF_STATE_Q4], x[UKF_STATE_ALTITUDE], x[UKF_STATE_POSN], x[UKF_STATE_POSE], x[UKF_STATE_POSD],
+                        x[UKF_STATE_VELN], x[UKF_STATE_VELE], x[UKF_STATE_VELD], x[UKF_STATE_PRES_ALT], ALT_POS, ALT_VEL);
                 break;
+            }
             case AQMAV_DATASET_SUPERVISOR :
                 mavlink_msg_aq_telemetry_f_send(MAVLINK_COMM_0, i, supervisorData.state, supervisorData.flightTime, 0, 0,
                         supervisorData.vInLPF, 0, supervisorData.lastGoodRadioMicros, supervisorData.idlePercent, 0,0,0,0,0,0,0,0, commData.txBufStarved, analogData.vIn, RADIO_QUALITY, RADIO_ERROR_COUNT);
@@ -335,9 +588,16 @@ void mavlinkDo(void) {
                         navData.holdSpeedN, navData.holdSpeedE, navData.holdSpeedAlt, navData.targetHoldSpeedAlt, navData.presAltOffset, 0, 0, 0, 0, 0, 0, 0, micros - navData.lastUpdate, navData.fixType);
                 break;
             case AQMAV_DATASET_IMU :
-                mavlink_msg_aq_telemetry_f_send(MAVLINK_COMM_0, i, AQ_ROLL, AQ_PITCH, AQ_YAW, IMU_RATEX, IMU_RATEY, IMU_RATEZ, IMU_ACCX, IMU_ACCY, IMU_ACCZ, IMU_MAGX, IMU_MAGY, IMU_MAGZ,
-                        IMU_TEMP, micros - IMU_LASTUPD, 0, 0, 0, 0, 0, AQ_PRESSURE);
+            {
+                navUkfAttitude_t att;
+                imuSample_t imu;
+
+                navUkfGetAttitude(&att);
+                imuGetSample(&imu);
+                mavlink_msg_aq_telemetry_f_send(MAVLINK_COMM_0, i, att.roll, att.pitch, att.yaw, imu.rate[0], imu.rate[1], imu.rate[2], imu.acc[0], imu.acc[1], imu.acc[2], imu.mag[0], imu.mag[1], imu.mag[2],
+                        imu.temp, micros - imu.lastUpdate, 0, 0, 0, 0, 0, imu.pressure);
                 break;
+            }
             case AQMAV_DATASET_RC :
                 mavlink_msg_aq_telemetry_f_send(MAVLINK_COMM_0, i, RADIO_THROT, RADIO_RUDD, RADIO_PITCH, RADIO_ROLL, rcIsSwitchActive(NAV_CTRL_AH), rcIsSwitchActive(NAV_CTRL_PH),
                         rcIsSwitchActive(NAV_CTRL_MISN), rcIsSwitchActive(NAV_CTRL_HOM_SET), rcIsSwitchActive(NAV_CTRL_HOM_GO), rcIsSwitchActive(NAV_CTRL_HF_SET), rcIsSwitchActive(NAV_CTRL_HF_LOCK),
@@ -354,6 +614,38 @@ void mavlinkDo(void) {
                         configGetAdjParamId(CONFIG_ADJUST_P6), (configGetAdjParamId(CONFIG_ADJUST_P6) ? configGetParamValue(configGetAdjParamId(CONFIG_ADJUST_P6)) : 0),
                         0, 0, 0, 0, 0, 0, 0, 0);
                 break;
+#ifdef UTIL_TASK_STATS
+            case AQMAV_DATASET_TASKS :
+            {
+                // one task per stream cycle, skip task slots which never ran
+                utilTaskStats_t *t;
+                uint8_t n = 0;
+                do {
+                    if (++mavlinkData.indexTask >= UTIL_TASK_STATS)
+                        mavlinkData.indexTask = 0;
+                    t = &utilTaskStatsData.tasks[mavlinkData.indexTask];
+                } while (!t->activations && ++n < UTIL_TASK_STATS);
+
+                mavlink_msg_aq_telemetry_f_send(MAVLINK_COMM_0, i,
+                        /* ints */ mavlinkData.indexTask, CoGetTaskPriority(mavlinkData.indexTask), t->activations, t->runTime / 1000, t->maxRun, t->maxLatency, 0, 0, 0, 0,
+                        /*floats*/ t->cpuPercent, supervisorData.idlePercent, 0, 0, 0, 0, 0, 0, 0, 0);
+                break;
+            }
+#endif
+            case AQMAV_DATASET_VIBE :
+            {
+                // one channel per stream cycle: acc x, y, z then gyo x, y, z
+                vibeChannel_t v;
+
+                if (++mavlinkData.indexVibe >= VIBE_CHANNELS)
+                    mavlinkData.indexVibe = 0;
+                vibeGetChannel(mavlinkData.indexVibe, &v);
+
+                mavlink_msg_aq_telemetry_f_send(MAVLINK_COMM_0, i,
+                        /* ints */ mavlinkData.indexVibe, v.freq[0], v.freq[1], v.freq[2], v.amp[0], v.amp[1], v.amp[2], v.rms,
+                        /* bands */ v.band[0], v.band[1], v.band[2], v.band[3], v.band[4], v.band[5], v.band[6], v.band[7], v.band[8], v.band[9], v.band[10], v.band[11]);
+                break;
+            }
             case AQMAV_DATASET_DEBUG :
                 // First 10 values are displayed in QGC as integers, the other 10 as floats.
                 mavlink_msg_aq_telemetry_f_send(MAVLINK_COMM_0, i,
@@ -363,9 +655,134 @@ void mavlinkDo(void) {
             }
         }
 
-        mavlinkData.streams[MAV_DATA_STREAM_EXTRA3].next = micros + mavlinkData.streams[MAV_DATA_STREAM_EXTRA3].interval;
+        break;
+    }
     }
-    // end streams
+}
+
+// streams which have something to send and their current interval, STREAM_ALL sets a common minimum rate
+static uint32_t mavlinkStreamInterval(uint8_t i) {
+    mavlinkStreams_t *all = &mavlinkData.streams[MAV_DATA_STREAM_ALL];
+    mavlinkStreams_t *st = &mavlinkData.streams[i];
+
+    if (i == MAV_DATA_STREAM_ALL || i == MAV_DATA_STREAM_EXTRA1 || i == MAV_DATA_STREAM_EXTRA2)
+        return 0;
+
+    if (all->enable && all->interval && (!st->enable || all->interval < st->interval))
+        return all->interval;
+
+    return st->enable ? st->interval : 0;
+}
+
+// take bytes queued since last call off the link budget
+static void mavlinkChargeCredit(void) {
+    mavlinkData.txCredit -= (int32_t)(mavlinkData.txBytes - mavlinkData.txBytesCharged);
+    mavlinkData.txBytesCharged = mavlinkData.txBytes;
+}
+
+// refill the link budget and back off while the comm layer is dropping packets
+static void mavlinkUpdateCredit(unsigned long micros, unsigned long dt) {
+    uint32_t drops, max;
+    int i;
+
+    drops = commData.txBufStarved;
+    for (i = 0; i < COMM_NUM_PORTS; i++)
+        if (commData.portStreams[i] & COMM_STREAM_TYPE_MAVLINK)
+            drops += commData.txStackOverruns[i];
+
+    if (drops != mavlinkData.txDrops) {
+        mavlinkData.txScale = (mavlinkData.txScale > AQMAVLINK_LINK_SCALE_MIN * 2.0f) ? mavlinkData.txScale * 0.5f : AQMAVLINK_LINK_SCALE_MIN;
+        mavlinkData.txDrops = drops;
+        mavlinkData.nextScaleUp = micros + AQMAVLINK_LINK_RECOVER;
+    }
+    else if (mavlinkData.txScale < 1.0f && mavlinkData.nextScaleUp < micros) {
+        mavlinkData.txScale = (mavlinkData.txScale < 1.0f - AQMAVLINK_LINK_SCALE_MIN) ? mavlinkData.txScale + AQMAVLINK_LINK_SCALE_MIN : 1.0f;
+        mavlinkData.nextScaleUp = micros + AQMAVLINK_LINK_RECOVER;
+    }
+
+    if (dt > AQMAVLINK_LINK_RECOVER)
+        dt = AQMAVLINK_LINK_RECOVER;
+
+    mavlinkData.txCredit += (int32_t)(mavlinkData.linkRate * mavlinkData.txScale * dt * 1e-6f);
+    mavlinkChargeCredit();
+
+    max = mavlinkData.linkRate * AQMAVLINK_LINK_BURST;
+    if (max < MAVLINK_MAX_PACKET_LEN)
+        max = MAVLINK_MAX_PACKET_LEN;
+    if (mavlinkData.txCredit > (int32_t)max)
+        mavlinkData.txCredit = max;
+}
+
+// Send the most overdue streams, a few per cycle and only while the link budget allows.
+// Deadlines advance by whole intervals so rates stay exact, streams which fell
+// more than an interval behind skip ahead instead of bursting.
+static void mavlinkScheduleStreams(unsigned long micros) {
+    unsigned long late;
+    uint32_t interval;
+    int8_t s;
+    int i, n;
+
+    for (n = 0; n < AQMAVLINK_STREAMS_PER_CYCLE && mavlinkData.txCredit > 0; n++) {
+        s = -1;
+        late = 0;
+
+        for (i = 0; i < AQMAVLINK_TOTAL_STREAMS; i++) {
+            if (!(interval = mavlinkStreamInterval(i)))
+                continue;
+
+            // newly enabled, phase streams apart
+            if (!mavlinkData.streams[i].next) {
+                mavlinkData.streams[i].next = micros + interval / AQMAVLINK_TOTAL_STREAMS * i;
+                continue;
+            }
+
+            if (mavlinkData.streams[i].next <= micros && micros - mavlinkData.streams[i].next >= late) {
+                late = micros - mavlinkData.streams[i].next;
+                s = i;
+            }
+        }
+
+        if (s < 0)
+            break;
+
+        mavlinkSendStream(s, micros);
+        mavlinkChargeCredit();
+
+        interval = mavlinkStreamInterval(s);
+        mavlinkData.streams[s].next += interval;
+        if (mavlinkData.streams[s].next <= micros)
+            mavlinkData.streams[s].next = micros + interval;
+    }
+}
+
+void mavlinkDo(void) {
+    static unsigned long lastMicros = 0;
+    unsigned long micros;
+
+    micros = timerMicros();
+
+    // handle rollover
+    if (micros < lastMicros) {
+        mavlinkData.nextHeartbeat = 0;
+        mavlinkData.nextParam = 0;
+        mavlinkData.nextWP = 0;
+        mavlinkData.nextScaleUp = 0;
+        for (uint8_t i=0; i < AQMAVLINK_TOTAL_STREAMS; ++i)
+            mavlinkData.streams[i].next = 0;
+    }
+
+    supervisorSendDataStart();
+
+    // heartbeat
+    if (mavlinkData.nextHeartbeat < micros) {
+        mavlinkSetSystemData();
+        mavlink_msg_heartbeat_send(MAVLINK_COMM_0, mavlinkData.sys_type, MAV_AUTOPILOT_AUTOQUAD, mavlinkData.sys_mode, supervisorData.systemStatus, mavlinkData.sys_state);
+        mavlinkData.nextHeartbeat = micros + AQMAVLINK_HEARTBEAT_INTERVAL;
+    }
+
+    // send streams
+    mavlinkUpdateCredit(micros, micros - lastMicros);
+    mavlinkScheduleStreams(micros);
 
     // list all requested/remaining parameters
     if (mavlinkData.currentParam < CONFIG_NUM_PARAMS && mavlinkData.nextParam < micros) {
@@ -389,6 +806,40 @@ void mavlinkDo(void) {
         mavlinkData.nextParam = micros + AQMAVLINK_PARAM_INTERVAL;
     }
 
+    // log list and download
+    if (mavlinkData.logListing)
+        mavlinkLogListPoll();
+    if (mavlinkData.logListNext && mavlinkData.logListNext <= mavlinkData.logListEnd && mavlinkData.nextParam < micros) {
+        filerLogEntry_t *e = &mavlinkData.logList[mavlinkData.logListNext-1];
+
+        mavlink_msg_log_entry_send(MAVLINK_COMM_0, mavlinkData.logListNext, mavlinkData.logCount, mavlinkData.logCount, 0, e->size);
+        mavlinkData.logListNext++;
+        mavlinkData.nextParam = micros + AQMAVLINK_PARAM_INTERVAL;
+    }
+    if (mavlinkData.logId && mavlinkData.txCredit > 0) {
+        mavlinkLogService();
+        mavlinkChargeCredit();
+    }
+
+    // send outstanding bulk param packets
+    if (mavlinkData.bulkType == AQMAVLINK_BULK_PARAM_READ && mavlinkData.nextBulk < micros && mavlinkData.txCredit > 0) {
+        uint8_t data[253];
+        uint16_t off = mavlinkData.bulkSeq * AQMAVLINK_BULK_CHUNK;
+        uint16_t len = AQMAVLINK_BULK_SIZE - off;
+
+        if (len > AQMAVLINK_BULK_CHUNK)
+            len = AQMAVLINK_BULK_CHUNK;
+
+        memset(data, 0, sizeof(data));
+        memcpy(data, mavlinkData.bulkBuf + off, len);
+        mavlink_msg_encapsulated_data_send(MAVLINK_COMM_0, mavlinkData.bulkSeq, data);
+
+        if (++mavlinkData.bulkSeq >= AQMAVLINK_BULK_PACKETS)
+            mavlinkData.bulkType = 0;
+
+        mavlinkData.nextBulk = micros + AQMAVLINK_BULK_INTERVAL;
+    }
+
     // request announced waypoints from mission planner
     if (mavlinkData.wpCurrent < mavlinkData.wpCount && mavlinkData.wpAttempt <= AQMAVLINK_WP_MAX_ATTEMPTS && mavlinkData.nextWP < micros) {
         mavlinkData.wpAttempt++;
@@ -585,393 +1036,565 @@ void mavlinkDoCommand(mavlink_message_t *msg) {
 #endif
 }
 
-void mavlinkRecvTaskCode(commRcvrStruct_t *r) {
-    mavlink_message_t msg;
-    uint8_t c, ack;
-
-    // process incoming data
-    while (commAvailable(r)) {
-        c = commReadChar(r);
-        // Try to get a new message
-        if (mavlink_parse_char(MAVLINK_COMM_0, c, &msg, &mavlinkData.mavlinkStatus)) {
-            // Handle message
-            switch(msg.msgid) {
-            // TODO: finish this block
-            case MAVLINK_MSG_ID_COMMAND_LONG:
-                if (mavlink_msg_command_long_get_target_system(&msg) == mavlink_system.sysid) {
-                    mavlinkDoCommand(&msg);
-                }
-                break;
+static void mavlinkHandleMessage(mavlink_message_t *msg) {
+    uint8_t ack;
 
-            case MAVLINK_MSG_ID_CHANGE_OPERATOR_CONTROL:
-                if (mavlink_msg_change_operator_control_get_target_system(&msg) == mavlink_system.sysid) {
-                    mavlink_msg_change_operator_control_ack_send(MAVLINK_COMM_0, msg.sysid, mavlink_msg_change_operator_control_get_control_request(&msg), 0);
-                }
-                break;
+    switch(msg->msgid) {
+    // TODO: finish this block
+    case MAVLINK_MSG_ID_COMMAND_LONG:
+        if (mavlink_msg_command_long_get_target_system(msg) == mavlink_system.sysid) {
+            mavlinkDoCommand(msg);
+        }
+        break;
 
-                //  case MAVLINK_MSG_ID_SET_MODE:
-                //      if (mavlink_msg_set_mode_get_target_system(&msg) == mavlink_system.sysid) {
-                //          mavlinkData.sys_mode = mavlink_msg_set_mode_get_base_mode(&msg);
-                //          mavlink_msg_sys_status_send(MAVLINK_COMM_0, 0, 0, 0, 1000-mavlinkData.idlePercent, analogData.vIn * 1000, -1, (analogData.vIn - 9.8f) / 12.6f * 1000, 0, mavlinkData.packetDrops, 0, 0, 0, 0);
-                //      }
-                //      break;
+    case MAVLINK_MSG_ID_CHANGE_OPERATOR_CONTROL:
+        if (mavlink_msg_change_operator_control_get_target_system(msg) == mavlink_system.sysid) {
+            mavlink_msg_change_operator_control_ack_send(MAVLINK_COMM_0, msg->sysid, mavlink_msg_change_operator_control_get_control_request(msg), 0);
+        }
+        break;
 
-            case MAVLINK_MSG_ID_MISSION_REQUEST_LIST:
-                if (mavlink_msg_mission_request_list_get_target_system(&msg) == mavlink_system.sysid)
-                    mavlinkWpSendCount();
-                break;
+        //  case MAVLINK_MSG_ID_SET_MODE:
+        //      if (mavlink_msg_set_mode_get_target_system(msg) == mavlink_system.sysid) {
+        //          mavlinkData.sys_mode = mavlink_msg_set_mode_get_base_mode(msg);
+        //          mavlink_msg_sys_status_send(MAVLINK_COMM_0, 0, 0, 0, 1000-mavlinkData.idlePercent, analogData.vIn * 1000, -1, (analogData.vIn - 9.8f) / 12.6f * 1000, 0, mavlinkData.packetDrops, 0, 0, 0, 0);
+        //      }
+        //      break;
 
-            case MAVLINK_MSG_ID_MISSION_CLEAR_ALL:
-                if (mavlink_msg_mission_clear_all_get_target_system(&msg) == mavlink_system.sysid) {
+    case MAVLINK_MSG_ID_MISSION_REQUEST_LIST:
+        if (mavlink_msg_mission_request_list_get_target_system(msg) == mavlink_system.sysid)
+            mavlinkWpSendCount();
+        break;
+
+    case MAVLINK_MSG_ID_MISSION_CLEAR_ALL:
+        if (mavlink_msg_mission_clear_all_get_target_system(msg) == mavlink_system.sysid) {
 #ifdef MAVLINK_V2
-                    mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid,
-                                                 MAV_COMP_ID_MISSIONPLANNER,
-                                                 (navClearWaypoints() ? MAV_MISSION_ACCEPTED : MAV_MISSION_ERROR),
-                                                 MAV_MISSION_TYPE_MISSION);
+            mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid,
+                                         MAV_COMP_ID_MISSIONPLANNER,
+                                         (navClearWaypoints() ? MAV_MISSION_ACCEPTED : MAV_MISSION_ERROR),
+                                         MAV_MISSION_TYPE_MISSION);
 #else
-                    mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, MAV_COMP_ID_MISSIONPLANNER, (navClearWaypoints() ? MAV_MISSION_ACCEPTED : MAV_MISSION_ERROR));
+            mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, MAV_COMP_ID_MISSIONPLANNER, (navClearWaypoints() ? MAV_MISSION_ACCEPTED : MAV_MISSION_ERROR));
 #endif
-                }
-                break;
-
-            case MAVLINK_MSG_ID_MISSION_REQUEST:
-                if (mavlink_msg_mission_request_get_target_system(&msg) == mavlink_system.sysid) {
-                    uint16_t seqId;
-                    uint16_t mavFrame;
-                    navMission_t *wp;
-
-                    seqId = mavlink_msg_mission_request_get_seq(&msg);
-                    wp = navGetWaypoint(seqId);
-                    if (wp->relativeAlt == 1)
-                        mavFrame = MAV_FRAME_GLOBAL_RELATIVE_ALT;
-                    else
-                        mavFrame = MAV_FRAME_GLOBAL;
+        }
+        break;
 
-                    if (wp->type == NAV_LEG_HOME) {
-                        wp = navGetHomeWaypoint();
+    case MAVLINK_MSG_ID_MISSION_REQUEST:
+        if (mavlink_msg_mission_request_get_target_system(msg) == mavlink_system.sysid) {
+            uint16_t seqId;
+            uint16_t mavFrame;
+            navMission_t *wp;
+
+            seqId = mavlink_msg_mission_request_get_seq(msg);
+            wp = navGetWaypoint(seqId);
+            if (wp->relativeAlt == 1)
+                mavFrame = MAV_FRAME_GLOBAL_RELATIVE_ALT;
+            else
+                mavFrame = MAV_FRAME_GLOBAL;
+
+            if (wp->type == NAV_LEG_HOME) {
+                wp = navGetHomeWaypoint();
 #ifdef MAVLINK_V2
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, MAV_FRAME_GLOBAL, MAV_CMD_NAV_RETURN_TO_LAUNCH, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        wp->targetRadius, wp->loiterTime/1000, 0.0f, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, MAV_FRAME_GLOBAL, MAV_CMD_NAV_RETURN_TO_LAUNCH, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                wp->targetRadius, wp->loiterTime/1000, 0.0f, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
 #else
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, MAV_FRAME_GLOBAL, MAV_CMD_NAV_RETURN_TO_LAUNCH, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        wp->targetRadius, wp->loiterTime/1000, 0.0f, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, MAV_FRAME_GLOBAL, MAV_CMD_NAV_RETURN_TO_LAUNCH, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                wp->targetRadius, wp->loiterTime/1000, 0.0f, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt);
 #endif
-                    }
-                    else if (wp->type == NAV_LEG_GOTO) {
+            }
+            else if (wp->type == NAV_LEG_GOTO) {
 #ifdef MAVLINK_V2
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, mavFrame, MAV_CMD_NAV_WAYPOINT, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        wp->targetRadius, wp->loiterTime/1000, wp->maxHorizSpeed, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, mavFrame, MAV_CMD_NAV_WAYPOINT, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                wp->targetRadius, wp->loiterTime/1000, wp->maxHorizSpeed, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
 #else
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, mavFrame, MAV_CMD_NAV_WAYPOINT, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        wp->targetRadius, wp->loiterTime/1000, wp->maxHorizSpeed, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, mavFrame, MAV_CMD_NAV_WAYPOINT, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                wp->targetRadius, wp->loiterTime/1000, wp->maxHorizSpeed, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt);
 #endif
-                    }
-                    else if (wp->type == NAV_LEG_TAKEOFF) {
+            }
+            else if (wp->type == NAV_LEG_TAKEOFF) {
 #ifdef MAVLINK_V2
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, mavFrame, MAV_CMD_NAV_TAKEOFF, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        wp->targetRadius, wp->loiterTime/1000, wp->poiHeading, wp->maxVertSpeed, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, mavFrame, MAV_CMD_NAV_TAKEOFF, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                wp->targetRadius, wp->loiterTime/1000, wp->poiHeading, wp->maxVertSpeed, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
 #else
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, mavFrame, MAV_CMD_NAV_TAKEOFF, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        wp->targetRadius, wp->loiterTime/1000, wp->poiHeading, wp->maxVertSpeed, wp->targetLat, wp->targetLon, wp->targetAlt);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, mavFrame, MAV_CMD_NAV_TAKEOFF, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                wp->targetRadius, wp->loiterTime/1000, wp->poiHeading, wp->maxVertSpeed, wp->targetLat, wp->targetLon, wp->targetAlt);
 #endif
-                    }
-                    else if (wp->type == NAV_LEG_ORBIT) {
+            }
+            else if (wp->type == NAV_LEG_ORBIT) {
 #ifdef MAVLINK_V2
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, mavFrame, 1, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        wp->targetRadius, wp->loiterTime/1000, wp->maxHorizSpeed, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, mavFrame, 1, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                wp->targetRadius, wp->loiterTime/1000, wp->maxHorizSpeed, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
 #else
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, mavFrame, 1, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        wp->targetRadius, wp->loiterTime/1000, wp->maxHorizSpeed, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, mavFrame, 1, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                wp->targetRadius, wp->loiterTime/1000, wp->maxHorizSpeed, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt);
 #endif
-                    }
-                    else if (wp->type == NAV_LEG_LAND) {
+            }
+            else if (wp->type == NAV_LEG_LAND) {
 #ifdef MAVLINK_V2
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, mavFrame, MAV_CMD_NAV_LAND, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        0.0f, wp->maxVertSpeed, wp->maxHorizSpeed, wp->poiAltitude, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, mavFrame, MAV_CMD_NAV_LAND, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                0.0f, wp->maxVertSpeed, wp->maxHorizSpeed, wp->poiAltitude, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
 #else
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, mavFrame, MAV_CMD_NAV_LAND, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        0.0f, wp->maxVertSpeed, wp->maxHorizSpeed, wp->poiAltitude, wp->targetLat, wp->targetLon, wp->targetAlt);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, mavFrame, MAV_CMD_NAV_LAND, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                0.0f, wp->maxVertSpeed, wp->maxHorizSpeed, wp->poiAltitude, wp->targetLat, wp->targetLon, wp->targetAlt);
 #endif
-                    }
-                    else {
+            }
+            else {
 #ifdef MAVLINK_V2
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, mavFrame, MAV_CMD_NAV_WAYPOINT, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        wp->targetRadius, wp->loiterTime/1000, 0.0f, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, mavFrame, MAV_CMD_NAV_WAYPOINT, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                wp->targetRadius, wp->loiterTime/1000, 0.0f, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt, MAV_MISSION_TYPE_MISSION);
 #else
-                        mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg.sysid, MAV_COMP_ID_MISSIONPLANNER,
-                                seqId, mavFrame, MAV_CMD_NAV_WAYPOINT, (navData.missionLeg == seqId) ? 1 : 0, 1,
-                                        wp->targetRadius, wp->loiterTime/1000, 0.0f, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt);
+                mavlink_msg_mission_item_send(MAVLINK_COMM_0, msg->sysid, MAV_COMP_ID_MISSIONPLANNER,
+                        seqId, mavFrame, MAV_CMD_NAV_WAYPOINT, (navData.missionLeg == seqId) ? 1 : 0, 1,
+                                wp->targetRadius, wp->loiterTime/1000, 0.0f, wp->poiHeading, wp->targetLat, wp->targetLon, wp->targetAlt);
 #endif
-                    }
-                }
-                break; // MAVLINK_MSG_ID_MISSION_REQUEST
-
-            case MAVLINK_MSG_ID_MISSION_SET_CURRENT:
-                if (mavlink_msg_mission_count_get_target_system(&msg) == mavlink_system.sysid) {
-                    uint16_t seqId;
-                    ack = MAV_MISSION_ACCEPTED;
-
-                    seqId = mavlink_msg_mission_set_current_get_seq(&msg);
-                    if (seqId < NAV_MAX_MISSION_LEGS && navData.missionLegs[seqId].type)
-                        navLoadLeg(seqId);
-                    else
-                        ack = MAV_MISSION_INVALID_SEQUENCE;
+            }
+        }
+        break; // MAVLINK_MSG_ID_MISSION_REQUEST
+
+    case MAVLINK_MSG_ID_MISSION_SET_CURRENT:
+        if (mavlink_msg_mission_count_get_target_system(msg) == mavlink_system.sysid) {
+            uint16_t seqId;
+            ack = MAV_MISSION_ACCEPTED;
+
+            seqId = mavlink_msg_mission_set_current_get_seq(msg);
+            if (seqId < NAV_MAX_MISSION_LEGS && navData.missionLegs[seqId].type)
+                navLoadLeg(seqId);
+            else
+                ack = MAV_MISSION_INVALID_SEQUENCE;
 #ifdef MAVLINK_V2
-                    mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack, MAV_MISSION_TYPE_MISSION);
+            mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack, MAV_MISSION_TYPE_MISSION);
 #else
-                    mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack);
+            mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack);
 #endif
-                }
-                break;
+        }
+        break;
 
-            case MAVLINK_MSG_ID_MISSION_COUNT:
-                if (mavlink_msg_mission_count_get_target_system(&msg) == mavlink_system.sysid) {
-                    uint8_t count;
+    case MAVLINK_MSG_ID_MISSION_COUNT:
+        if (mavlink_msg_mission_count_get_target_system(msg) == mavlink_system.sysid) {
+            uint8_t count;
 
-                    count = mavlink_msg_mission_count_get_count(&msg);
-                    if (count > NAV_MAX_MISSION_LEGS || navClearWaypoints() != 1) {
-                        // NACK
-                        ack = MAV_MISSION_NO_SPACE;
-                        AQ_PRINTF("Error: %u waypoints exceeds system maximum of %u.", count, NAV_MAX_MISSION_LEGS);
-                    }
-                    else {
-                        mavlinkData.wpTargetSysId = msg.sysid;
-                        mavlinkData.wpTargetCompId = msg.compid;
-                        mavlinkData.wpCount = count;
-                        mavlinkData.wpCurrent = mavlinkData.wpAttempt = 0;
-                        mavlinkData.nextWP = timerMicros();
-                        ack = MAV_MISSION_ACCEPTED;
-                    }
+            count = mavlink_msg_mission_count_get_count(msg);
+            if (count > NAV_MAX_MISSION_LEGS || navClearWaypoints() != 1) {
+                // NACK
+                ack = MAV_MISSION_NO_SPACE;
+                AQ_PRINTF("Error: %u waypoints exceeds system maximum of %u.", count, NAV_MAX_MISSION_LEGS);
+            }
+            else {
+                mavlinkData.wpTargetSysId = msg->sysid;
+                mavlinkData.wpTargetCompId = msg->compid;
+                mavlinkData.wpCount = count;
+                mavlinkData.wpCurrent = mavlinkData.wpAttempt = 0;
+                mavlinkData.nextWP = timerMicros();
+                ack = MAV_MISSION_ACCEPTED;
+            }
 #ifdef MAVLINK_V2
-                    mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack, MAV_MISSION_TYPE_MISSION);
+            mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack, MAV_MISSION_TYPE_MISSION);
 #else
-                    mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack);
+            mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack);
 #endif
-                }
-                break;
+        }
+        break;
 
-            case MAVLINK_MSG_ID_MISSION_ITEM:
-                if (mavlink_msg_mission_item_get_target_system(&msg) == mavlink_system.sysid) {
-                    uint16_t seqId;
-                    ack = MAV_MISSION_ACCEPTED;
-                    uint8_t frame;
+    case MAVLINK_MSG_ID_MISSION_ITEM:
+        if (mavlink_msg_mission_item_get_target_system(msg) == mavlink_system.sysid) {
+            uint16_t seqId;
+            ack = MAV_MISSION_ACCEPTED;
+            uint8_t frame;
 
-                    seqId = mavlink_msg_mission_item_get_seq(&msg);
-                    frame = mavlink_msg_mission_item_get_frame(&msg);
+            seqId = mavlink_msg_mission_item_get_seq(msg);
+            frame = mavlink_msg_mission_item_get_frame(msg);
 
-                    if (seqId >= NAV_MAX_MISSION_LEGS) {
-                        ack = MAV_MISSION_INVALID_SEQUENCE;
-                    }
-                    else if (frame != MAV_FRAME_GLOBAL && frame != MAV_FRAME_GLOBAL_RELATIVE_ALT) {
-                        ack = MAV_MISSION_INVALID;
+            if (seqId >= NAV_MAX_MISSION_LEGS) {
+                ack = MAV_MISSION_INVALID_SEQUENCE;
+            }
+            else if (frame != MAV_FRAME_GLOBAL && frame != MAV_FRAME_GLOBAL_RELATIVE_ALT) {
+                ack = MAV_MISSION_INVALID;
+            }
+            else {
+                navMission_t *wp;
+                uint8_t command;
+
+                command = mavlink_msg_mission_item_get_command(msg);
+                if (command == MAV_CMD_NAV_RETURN_TO_LAUNCH) {
+                    wp = navGetWaypoint(seqId);
+
+                    wp->type = NAV_LEG_HOME;
+
+                    wp = navGetHomeWaypoint();
+
+                    wp->type = NAV_LEG_GOTO;
+                    wp->targetLat = mavlink_msg_mission_item_get_x(msg);
+                    wp->targetLon = mavlink_msg_mission_item_get_y(msg);
+                    wp->targetAlt = mavlink_msg_mission_item_get_z(msg);
+                    wp->targetRadius = mavlink_msg_mission_item_get_param1(msg);
+                    wp->loiterTime = mavlink_msg_mission_item_get_param2(msg) * 1000;
+                    wp->poiHeading = mavlink_msg_mission_item_get_param4(msg);
+                    wp->maxHorizSpeed = NAV_DFLT_HOR_SPEED;
+                }
+                else if (command == MAV_CMD_NAV_WAYPOINT) {
+                    wp = navGetWaypoint(seqId);
+                    if (frame == MAV_FRAME_GLOBAL_RELATIVE_ALT)
+                        wp->relativeAlt = 1;
+                    else
+                        wp->relativeAlt = 0;
+
+                    wp->type = NAV_LEG_GOTO;
+                    wp->targetLat = mavlink_msg_mission_item_get_x(msg);
+                    wp->targetLon = mavlink_msg_mission_item_get_y(msg);
+                    wp->targetAlt = mavlink_msg_mission_item_get_z(msg);
+                    wp->targetRadius = mavlink_msg_mission_item_get_param1(msg);
+                    wp->loiterTime = mavlink_msg_mission_item_get_param2(msg) * 1000;
+                    wp->maxHorizSpeed = mavlink_msg_mission_item_get_param3(msg);
+                    wp->poiHeading = mavlink_msg_mission_item_get_param4(msg);
+                }
+                else if (command == MAV_CMD_DO_SET_HOME) {
+                    // use current location
+                    if (mavlink_msg_mission_item_get_current(msg)) {
+                        navSetHomeCurrent();
                     }
+                    // use given location
                     else {
-                        navMission_t *wp;
-                        uint8_t command;
-
-                        command = mavlink_msg_mission_item_get_command(&msg);
-                        if (command == MAV_CMD_NAV_RETURN_TO_LAUNCH) {
-                            wp = navGetWaypoint(seqId);
-
-                            wp->type = NAV_LEG_HOME;
-
-                            wp = navGetHomeWaypoint();
-
-                            wp->type = NAV_LEG_GOTO;
-                            wp->targetLat = mavlink_msg_mission_item_get_x(&msg);
-                            wp->targetLon = mavlink_msg_mission_item_get_y(&msg);
-                            wp->targetAlt = mavlink_msg_mission_item_get_z(&msg);
-                            wp->targetRadius = mavlink_msg_mission_item_get_param1(&msg);
-                            wp->loiterTime = mavlink_msg_mission_item_get_param2(&msg) * 1000;
-                            wp->poiHeading = mavlink_msg_mission_item_get_param4(&msg);
-                            wp->maxHorizSpeed = NAV_DFLT_HOR_SPEED;
-                        }
-                        else if (command == MAV_CMD_NAV_WAYPOINT) {
-                            wp = navGetWaypoint(seqId);
-                            if (frame == MAV_FRAME_GLOBAL_RELATIVE_ALT)
-                                wp->relativeAlt = 1;
-                            else
-                                wp->relativeAlt = 0;
-
-                            wp->type = NAV_LEG_GOTO;
-                            wp->targetLat = mavlink_msg_mission_item_get_x(&msg);
-                            wp->targetLon = mavlink_msg_mission_item_get_y(&msg);
-                            wp->targetAlt = mavlink_msg_mission_item_get_z(&msg);
-                            wp->targetRadius = mavlink_msg_mission_item_get_param1(&msg);
-                            wp->loiterTime = mavlink_msg_mission_item_get_param2(&msg) * 1000;
-                            wp->maxHorizSpeed = mavlink_msg_mission_item_get_param3(&msg);
-                            wp->poiHeading = mavlink_msg_mission_item_get_param4(&msg);
-                        }
-                        else if (command == MAV_CMD_DO_SET_HOME) {
-                            // use current location
-                            if (mavlink_msg_mission_item_get_current(&msg)) {
-                                navSetHomeCurrent();
-                            }
-                            // use given location
-                            else {
-                                wp = navGetHomeWaypoint();
-
-                                wp->type = NAV_LEG_GOTO;
-                                wp->targetLat = mavlink_msg_mission_item_get_x(&msg);
-                                wp->targetLon = mavlink_msg_mission_item_get_y(&msg);
-                                wp->targetAlt = mavlink_msg_mission_item_get_z(&msg);
-                                wp->targetRadius = mavlink_msg_mission_item_get_param1(&msg);
-                                wp->loiterTime = mavlink_msg_mission_item_get_param2(&msg) * 1000;
-                                wp->poiHeading = mavlink_msg_mission_item_get_param4(&msg);
-                                wp->maxHorizSpeed = NAV_DFLT_HOR_SPEED;
-                            }
-                        }
-                        else if (command == MAV_CMD_NAV_TAKEOFF) {
-                            wp = navGetWaypoint(seqId);
-                            if (frame == MAV_FRAME_GLOBAL_RELATIVE_ALT)
-                                wp->relativeAlt = 1;
-                            else
-                                wp->relativeAlt = 0;
-
-                            wp->type = NAV_LEG_TAKEOFF;
-                            wp->targetLat = mavlink_msg_mission_item_get_x(&msg);
-                            wp->targetLon = mavlink_msg_mission_item_get_y(&msg);
-                            wp->targetAlt = mavlink_msg_mission_item_get_z(&msg);
-                            wp->targetRadius = mavlink_msg_mission_item_get_param1(&msg);
-                            wp->loiterTime = mavlink_msg_mission_item_get_param2(&msg) * 1000;
-                            wp->poiHeading = mavlink_msg_mission_item_get_param3(&msg);
-                            wp->maxVertSpeed = mavlink_msg_mission_item_get_param4(&msg);
-                        }
-                        else if (command == MAV_CMD_AQ_NAV_LEG_ORBIT) {
-                            wp = navGetWaypoint(seqId);
-                            if (frame == MAV_FRAME_GLOBAL_RELATIVE_ALT)
-                                wp->relativeAlt = 1;
-                            else
-                                wp->relativeAlt = 0;
-
-                            wp->type = NAV_LEG_ORBIT;
-                            wp->targetLat = mavlink_msg_mission_item_get_x(&msg);
-                            wp->targetLon = mavlink_msg_mission_item_get_y(&msg);
-                            wp->targetAlt = mavlink_msg_mission_item_get_z(&msg);
-                            wp->targetRadius = mavlink_msg_mission_item_get_param1(&msg);
-                            wp->loiterTime = mavlink_msg_mission_item_get_param2(&msg) * 1000;
-                            wp->maxHorizSpeed = mavlink_msg_mission_item_get_param3(&msg);
-                            wp->poiHeading = mavlink_msg_mission_item_get_param4(&msg);
-                        }
-                        else if (command == MAV_CMD_NAV_LAND) {
-                            wp = navGetWaypoint(seqId);
-                            if (frame == MAV_FRAME_GLOBAL_RELATIVE_ALT)
-                                wp->relativeAlt = 1;
-                            else
-                                wp->relativeAlt = 0;
-
-                            wp->type = NAV_LEG_LAND;
-                            wp->targetLat = mavlink_msg_mission_item_get_x(&msg);
-                            wp->targetLon = mavlink_msg_mission_item_get_y(&msg);
-                            wp->targetAlt = mavlink_msg_mission_item_get_z(&msg);
-                            wp->maxVertSpeed = mavlink_msg_mission_item_get_param2(&msg);
-                            wp->maxHorizSpeed = mavlink_msg_mission_item_get_param3(&msg);
-                            wp->poiHeading = mavlink_msg_mission_item_get_param4(&msg);
-                        }
-                        else {
-                            // NACK
-                            ack = MAV_MISSION_UNSUPPORTED;
-                        }
+                        wp = navGetHomeWaypoint();
+
+                        wp->type = NAV_LEG_GOTO;
+                        wp->targetLat = mavlink_msg_mission_item_get_x(msg);
+                        wp->targetLon = mavlink_msg_mission_item_get_y(msg);
+                        wp->targetAlt = mavlink_msg_mission_item_get_z(msg);
+                        wp->targetRadius = mavlink_msg_mission_item_get_param1(msg);
+                        wp->loiterTime = mavlink_msg_mission_item_get_param2(msg) * 1000;
+                        wp->poiHeading = mavlink_msg_mission_item_get_param4(msg);
+                        wp->maxHorizSpeed = NAV_DFLT_HOR_SPEED;
                     }
+                }
+                else if (command == MAV_CMD_NAV_TAKEOFF) {
+                    wp = navGetWaypoint(seqId);
+                    if (frame == MAV_FRAME_GLOBAL_RELATIVE_ALT)
+                        wp->relativeAlt = 1;
+                    else
+                        wp->relativeAlt = 0;
+
+                    wp->type = NAV_LEG_TAKEOFF;
+                    wp->targetLat = mavlink_msg_mission_item_get_x(msg);
+                    wp->targetLon = mavlink_msg_mission_item_get_y(msg);
+                    wp->targetAlt = mavlink_msg_mission_item_get_z(msg);
+                    wp->targetRadius = mavlink_msg_mission_item_get_param1(msg);
+                    wp->loiterTime = mavlink_msg_mission_item_get_param2(msg) * 1000;
+                    wp->poiHeading = mavlink_msg_mission_item_get_param3(msg);
+                    wp->maxVertSpeed = mavlink_msg_mission_item_get_param4(msg);
+                }
+                else if (command == MAV_CMD_AQ_NAV_LEG_ORBIT) {
+                    wp = navGetWaypoint(seqId);
+                    if (frame == MAV_FRAME_GLOBAL_RELATIVE_ALT)
+                        wp->relativeAlt = 1;
+                    else
+                        wp->relativeAlt = 0;
+
+                    wp->type = NAV_LEG_ORBIT;
+                    wp->targetLat = mavlink_msg_mission_item_get_x(msg);
+                    wp->targetLon = mavlink_msg_mission_item_get_y(msg);
+                    wp->targetAlt = mavlink_msg_mission_item_get_z(msg);
+                    wp->targetRadius = mavlink_msg_mission_item_get_param1(msg);
+                    wp->loiterTime = mavlink_msg_mission_item_get_param2(msg) * 1000;
+                    wp->maxHorizSpeed = mavlink_msg_mission_item_get_param3(msg);
+                    wp->poiHeading = mavlink_msg_mission_item_get_param4(msg);
+                }
+                else if (command == MAV_CMD_NAV_LAND) {
+                    wp = navGetWaypoint(seqId);
+                    if (frame == MAV_FRAME_GLOBAL_RELATIVE_ALT)
+                        wp->relativeAlt = 1;
+                    else
+                        wp->relativeAlt = 0;
+
+                    wp->type = NAV_LEG_LAND;
+                    wp->targetLat = mavlink_msg_mission_item_get_x(msg);
+                    wp->targetLon = mavlink_msg_mission_item_get_y(msg);
+                    wp->targetAlt = mavlink_msg_mission_item_get_z(msg);
+                    wp->maxVertSpeed = mavlink_msg_mission_item_get_param2(msg);
+                    wp->maxHorizSpeed = mavlink_msg_mission_item_get_param3(msg);
+                    wp->poiHeading = mavlink_msg_mission_item_get_param4(msg);
+                }
+                else {
+                    // NACK
+                    ack = MAV_MISSION_UNSUPPORTED;
+                }
+            }
 
-                    mavlinkData.wpCurrent = seqId + 1;
-                    mavlinkData.wpAttempt = 0;
-                    mavlinkData.nextWP = timerMicros();
+            mavlinkData.wpCurrent = seqId + 1;
+            mavlinkData.wpAttempt = 0;
+            mavlinkData.nextWP = timerMicros();
 #ifdef MAVLINK_V2
-                    mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack, MAV_MISSION_TYPE_MISSION);
+            mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack, MAV_MISSION_TYPE_MISSION);
 #else
-                    mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack);
+            mavlink_msg_mission_ack_send(MAVLINK_COMM_0, mavlink_system.sysid, mavlink_system.compid, ack);
 #endif
-                }
-                break; //MAVLINK_MSG_ID_MISSION_ITEM
+        }
+        break; //MAVLINK_MSG_ID_MISSION_ITEM
 
-            case MAVLINK_MSG_ID_PARAM_REQUEST_READ:
-                if (mavlink_msg_param_request_read_get_target_system(&msg) == mavlink_system.sysid) {
-                    uint16_t paramIndex;
+    case MAVLINK_MSG_ID_PARAM_REQUEST_READ:
+        if (mavlink_msg_param_request_read_get_target_system(msg) == mavlink_system.sysid) {
+            uint16_t paramIndex;
 
-                    mavlinkData.paramCompId = mavlink_msg_param_request_read_get_target_component(&msg);
-                    paramIndex = mavlink_msg_param_request_read_get_param_index(&msg);
-                    if (paramIndex < CONFIG_NUM_PARAMS)
-                        mavlinkSendParamValue(paramIndex, CONFIG_NUM_PARAMS, false);
-                }
-                break;
+            mavlinkData.paramCompId = mavlink_msg_param_request_read_get_target_component(msg);
+            paramIndex = mavlink_msg_param_request_read_get_param_index(msg);
+            if (paramIndex < CONFIG_NUM_PARAMS)
+                mavlinkSendParamValue(paramIndex, CONFIG_NUM_PARAMS, false);
+        }
+        break;
 
-            case MAVLINK_MSG_ID_PARAM_REQUEST_LIST:
-                if (mavlink_msg_param_request_list_get_target_system(&msg) == mavlink_system.sysid) {
-                    mavlinkData.paramCompId = mavlink_msg_param_request_list_get_target_component(&msg);
-                    mavlinkData.currentParam = 0;
-                    mavlinkData.nextParam = 0;
-                }
-                break;
+    case MAVLINK_MSG_ID_PARAM_REQUEST_LIST:
+        if (mavlink_msg_param_request_list_get_target_system(msg) == mavlink_system.sysid) {
+            mavlinkData.paramCompId = mavlink_msg_param_request_list_get_target_component(msg);
+            mavlinkData.currentParam = 0;
+            mavlinkData.nextParam = 0;
+        }
+        break;
 
-            case MAVLINK_MSG_ID_PARAM_SET:
-                if (mavlink_msg_param_set_get_target_system(&msg) == mavlink_system.sysid) {
-                    int paramIndex;
-                    char paramName[17];
-
-                    mavlink_msg_param_set_get_param_id(&msg, paramName);
-                    paramIndex = configGetParamIdByName((char *)paramName);
-                    if (paramIndex > -1) {
-                        if (!(supervisorData.state & STATE_FLYING))
-                            configSetParamByID(paramIndex, mavlink_msg_param_set_get_param_value(&msg));
-                        // send back what we have no matter what
-                        mavlinkData.paramCompId = mavlink_msg_param_set_get_target_component(&msg);
-                        mavlinkSendParamValue(paramIndex, CONFIG_NUM_PARAMS, true);
-                    }
-                }
+    case MAVLINK_MSG_ID_LOG_REQUEST_LIST:
+        if (mavlink_msg_log_request_list_get_target_system(msg) == mavlink_system.sysid && mavlinkLogInit()) {
+            mavlinkData.logListStart = mavlink_msg_log_request_list_get_start(msg);
+            mavlinkData.logListStop = mavlink_msg_log_request_list_get_end(msg);
+
+            // a scan already under way will answer this request too
+            if (!mavlinkData.logListing) {
+                mavlinkLogRequestEnd();
+                mavlinkData.logCount = 0;
+
+                // the filer task runs at lowest priority, mavlinkDo() collects the result
+                if (filerListLogsAsync(mavlinkData.logHandle, LOGGER_FNAME ".LOG", mavlinkData.logList, FILER_MAX_LOGS) == FILER_STATUS_OK)
+                    mavlinkData.logListing = 1;
+                else
+                    mavlink_msg_log_entry_send(MAVLINK_COMM_0, 0, 0, 0, 0, 0);
+            }
+        }
+        break;
+
+    case MAVLINK_MSG_ID_LOG_REQUEST_DATA:
+        if (mavlink_msg_log_request_data_get_target_system(msg) == mavlink_system.sysid && mavlinkLogInit())
+            mavlinkLogRequestData(mavlink_msg_log_request_data_get_id(msg), mavlink_msg_log_request_data_get_ofs(msg), mavlink_msg_log_request_data_get_count(msg));
+        break;
+
+    case MAVLINK_MSG_ID_LOG_REQUEST_END:
+        if (mavlink_msg_log_request_end_get_target_system(msg) == mavlink_system.sysid && mavlinkLogInit())
+            mavlinkLogRequestEnd();
+        break;
+
+    case MAVLINK_MSG_ID_DATA_TRANSMISSION_HANDSHAKE:
+        {
+            uint8_t type = mavlink_msg_data_transmission_handshake_get_type(msg);
+
+            if (type != AQMAVLINK_BULK_PARAM_READ && type != AQMAVLINK_BULK_PARAM_WRITE)
                 break;
 
-            case MAVLINK_MSG_ID_REQUEST_DATA_STREAM:
-                if (mavlink_msg_request_data_stream_get_target_system(&msg) == mavlink_system.sysid) {
-                    uint16_t rate;
-                    uint8_t stream_id, enable;
-
-                    stream_id = mavlink_msg_request_data_stream_get_req_stream_id(&msg);
-                    rate = mavlink_msg_request_data_stream_get_req_message_rate(&msg);
-                    rate = constrainInt(rate, 0, 200);
-                    enable = mavlink_msg_request_data_stream_get_start_stop(&msg);
-
-                    // STREAM_ALL is special:
-                    // to disable all streams entirely (except heartbeat), set STREAM_ALL start = 0
-                    // to enable literally all streams at a certain rate, set STREAM_ALL rate > 0 and start = 1;
-                    // set rate = 0 and start = 1 to disable sending all data and return back to your regularly scheduled streams :)
-                    if (stream_id == MAV_DATA_STREAM_ALL)
-                        mavlinkToggleStreams(enable);
-
-                    if (stream_id < AQMAVLINK_TOTAL_STREAMS) {
-                        mavlinkData.streams[stream_id].enable = rate && enable;
-                        mavlinkData.streams[stream_id].interval = rate ? 1e6 / rate : 0;
-                        mavlink_msg_data_stream_send(MAVLINK_COMM_0, stream_id, rate, mavlinkData.streams[stream_id].enable);
-                    }
+            if (!mavlinkData.bulkBuf)
+                mavlinkData.bulkBuf = (uint8_t *)aqDataCalloc(AQMAVLINK_BULK_SIZE, sizeof(uint8_t));
+
+            mavlinkData.paramCompId = msg->compid;
+
+            if (type == AQMAVLINK_BULK_PARAM_READ) {
+                mavlinkBulkRead(mavlink_msg_data_transmission_handshake_get_width(msg));
+            }
+            else {
+                mavlinkData.bulkType = AQMAVLINK_BULK_PARAM_WRITE;
+                mavlinkData.bulkCrc = mavlink_msg_data_transmission_handshake_get_width(msg);
+                mavlinkData.bulkRecvd = 0;
+
+                // refuse a blob that does not match our layout
+                if (mavlink_msg_data_transmission_handshake_get_size(msg) != AQMAVLINK_BULK_SIZE) {
+                    mavlinkBulkSendHandshake(0, 0);
+                    mavlinkData.bulkType = 0;
                 }
-                break;
+                else {
+                    mavlinkBulkSendHandshake(AQMAVLINK_BULK_PACKETS, AQMAVLINK_BULK_SIZE);
+                }
+            }
+        }
+        break;
 
-            case MAVLINK_MSG_ID_OPTICAL_FLOW:
-                navUkfOpticalFlow(mavlink_msg_optical_flow_get_flow_x(&msg),
-                        mavlink_msg_optical_flow_get_flow_y(&msg),
-                        mavlink_msg_optical_flow_get_quality(&msg),
-                        mavlink_msg_optical_flow_get_ground_distance(&msg));
-                break;
+    case MAVLINK_MSG_ID_ENCAPSULATED_DATA:
+        if (mavlinkData.bulkType == AQMAVLINK_BULK_PARAM_WRITE) {
+            uint8_t data[253];
+            uint16_t seq, off, len;
 
-            default:
-                // Do nothing
+            seq = mavlink_msg_encapsulated_data_get_seqnr(msg);
+            if (seq >= AQMAVLINK_BULK_PACKETS)
                 break;
+
+            off = seq * AQMAVLINK_BULK_CHUNK;
+            len = AQMAVLINK_BULK_SIZE - off;
+            if (len > AQMAVLINK_BULK_CHUNK)
+                len = AQMAVLINK_BULK_CHUNK;
+
+            mavlink_msg_encapsulated_data_get_data(msg, data);
+            memcpy(mavlinkData.bulkBuf + off, data, len);
+            mavlinkData.bulkRecvd |= (1<<seq);
+
+            if (mavlinkData.bulkRecvd == (1<<AQMAVLINK_BULK_PACKETS) - 1)
+                mavlinkBulkWrite();
+        }
+        break;
+
+    case MAVLINK_MSG_ID_PARAM_SET:
+        if (mavlink_msg_param_set_get_target_system(msg) == mavlink_system.sysid) {
+            int paramIndex;
+            char paramName[17];
+
+            mavlink_msg_param_set_get_param_id(msg, paramName);
+            paramIndex = configGetParamIdByName((char *)paramName);
+            if (paramIndex > -1) {
+                if (!(supervisorData.state & STATE_FLYING))
+                    configSetParamByID(paramIndex, mavlink_msg_param_set_get_param_value(msg));
+                // send back what we have no matter what
+                mavlinkData.paramCompId = mavlink_msg_param_set_get_target_component(msg);
+                mavlinkSendParamValue(paramIndex, CONFIG_NUM_PARAMS, true);
             }
         }
+        break;
 
-        // Update global packet drops counter
-        mavlinkData.packetDrops += mavlinkData.mavlinkStatus.packet_rx_drop_count;
+    case MAVLINK_MSG_ID_REQUEST_DATA_STREAM:
+        if (mavlink_msg_request_data_stream_get_target_system(msg) == mavlink_system.sysid) {
+            uint16_t rate;
+            uint8_t stream_id, enable;
+
+            stream_id = mavlink_msg_request_data_stream_get_req_stream_id(msg);
+            rate = mavlink_msg_request_data_stream_get_req_message_rate(msg);
+            rate = constrainInt(rate, 0, 200);
+            enable = mavlink_msg_request_data_stream_get_start_stop(msg);
+
+            // STREAM_ALL is special:
+            // to disable all streams entirely (except heartbeat), set STREAM_ALL start = 0
+            // to enable literally all streams at a certain rate, set STREAM_ALL rate > 0 and start = 1;
+            // set rate = 0 and start = 1 to disable sending all data and return back to your regularly scheduled streams :)
+            if (stream_id == MAV_DATA_STREAM_ALL)
+                mavlinkToggleStreams(enable);
+
+            if (stream_id < AQMAVLINK_TOTAL_STREAMS) {
+                mavlinkData.streams[stream_id].enable = rate && enable;
+                mavlinkData.streams[stream_id].interval = rate ? 1e6 / rate : 0;
+                mavlinkData.streams[stream_id].next = 0;
+                mavlink_msg_data_stream_send(MAVLINK_COMM_0, stream_id, rate, mavlinkData.streams[stream_id].enable);
+            }
+        }
+        break;
+
+    case MAVLINK_MSG_ID_OPTICAL_FLOW:
+        navUkfOpticalFlow(mavlink_msg_optical_flow_get_flow_x(msg),
+                mavlink_msg_optical_flow_get_flow_y(msg),
+                mavlink_msg_optical_flow_get_quality(msg),
+                mavlink_msg_optical_flow_get_ground_distance(msg));
+        break;
+
+    default:
+        // Do nothing
+        break;
+    }
+}
+
+// skip line noise up to the next frame start while the parser is idle
+static uint16_t mavlinkSkipToStx(uint8_t *buf, uint16_t n) {
+    uint16_t i;
+
+    if (mavlinkData.mavlinkStatus.parse_state > MAVLINK_PARSE_STATE_IDLE)
+        return 0;
+
+    for (i = 0; i < n; i++)
+#ifdef MAVLINK_V2
+        if (buf[i] == MAVLINK_STX || buf[i] == MAVLINK_STX_MAVLINK1)
+#else
+        if (buf[i] == MAVLINK_STX)
+#endif
+            break;
+
+    return i;
+}
+
+#ifndef MAVLINK_V2
+// Decode a complete v1 frame straight from the receive span, returns its
+// length or zero to leave it to mavlink_parse_char(), which then also
+// accounts for frames failing the CRC.
+static uint16_t mavlinkFrameInPlace(uint8_t *buf, uint16_t n, mavlink_message_t *msg) {
+    static const uint8_t crcs[256] = MAVLINK_MESSAGE_CRCS;
+    mavlink_status_t *status;
+    uint16_t len, crc;
+
+    if (n < MAVLINK_NUM_NON_PAYLOAD_BYTES || buf[0] != MAVLINK_STX)
+        return 0;
+
+    len = buf[1];
+    if (n < len + MAVLINK_NUM_NON_PAYLOAD_BYTES)
+        return 0;
+
+    // header and payload, then the message's CRC extra
+    crc = crc_calculate(&buf[1], MAVLINK_CORE_HEADER_LEN + len);
+    crc_accumulate(crcs[buf[5]], &crc);
+
+    if (buf[MAVLINK_NUM_HEADER_BYTES + len] != (crc & 0xff) || buf[MAVLINK_NUM_HEADER_BYTES + len + 1] != (crc >> 8))
+        return 0;
+
+    msg->magic = MAVLINK_STX;
+    msg->len = len;
+    msg->seq = buf[2];
+    msg->sysid = buf[3];
+    msg->compid = buf[4];
+    msg->msgid = buf[5];
+    msg->checksum = crc;
+    memcpy(_MAV_PAYLOAD_NON_CONST(msg), &buf[MAVLINK_NUM_HEADER_BYTES], len);
+
+    // keep the library's channel statistics as if it had parsed the frame
+    status = mavlink_get_channel_status(MAVLINK_COMM_0);
+    status->current_rx_seq = msg->seq;
+    status->packet_rx_success_count++;
+
+    mavlinkData.mavlinkStatus.current_rx_seq = msg->seq + 1;
+    mavlinkData.mavlinkStatus.packet_rx_success_count = status->packet_rx_success_count;
+    mavlinkData.mavlinkStatus.packet_rx_drop_count = 0;
+
+    return len + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+}
+#endif
+
+void mavlinkRecvTaskCode(commRcvrStruct_t *r) {
+    mavlink_message_t msg;
+    uint8_t *buf;
+    uint16_t n, i;
+#ifndef MAVLINK_V2
+    uint16_t len;
+#endif
+
+    // process incoming data a contiguous span at a time
+    while ((n = commRxSpan(r, &buf)) > 0) {
+        i = mavlinkSkipToStx(buf, n);
+
+        while (i < n) {
+#ifndef MAVLINK_V2
+            // frames lying whole in the span bypass the byte parser
+            if (mavlinkData.mavlinkStatus.parse_state <= MAVLINK_PARSE_STATE_IDLE && (len = mavlinkFrameInPlace(&buf[i], n - i, &msg)) > 0) {
+                mavlinkHandleMessage(&msg);
+                i += len;
+                i += mavlinkSkipToStx(&buf[i], n - i);
+                continue;
+            }
+#endif
+            // Try to get a new message
+            if (mavlink_parse_char(MAVLINK_COMM_0, buf[i++], &msg, &mavlinkData.mavlinkStatus)) {
+                mavlinkHandleMessage(&msg);
+                i += mavlinkSkipToStx(&buf[i], n - i);
+            }
+
+            // Update global packet drops counter
+            mavlinkData.packetDrops += mavlinkData.mavlinkStatus.packet_rx_drop_count;
+        }
+
+        commRxConsume(r, n);
     }
 }
 
@@ -1042,6 +1665,14 @@ void mavlinkInit(void) {
     mavlinkData.streams[MAV_DATA_STREAM_EXTRA3].dfltInterval = AQMAVLINK_STREAM_RATE_EXTRA3;
     mavlinkData.streams[MAV_DATA_STREAM_PROPULSION].dfltInterval = AQMAVLINK_STREAM_RATE_PROPULSION;
 
+    // stream budget from the slowest serial port carrying mavlink
+    mavlinkData.linkRate = AQMAVLINK_LINK_RATE_MAX;
+    for (i = 0; i < COMM_NUM_SERIAL; i++) {
+        if ((commData.portStreams[i] & COMM_STREAM_TYPE_MAVLINK) && p[COMM_BAUD1+i] * (AQMAVLINK_LINK_SHARE / 10.0f) < mavlinkData.linkRate)
+            mavlinkData.linkRate = p[COMM_BAUD1+i] * (AQMAVLINK_LINK_SHARE / 10.0f);
+    }
+    mavlinkData.txScale = 1.0f;
+
     // turn on streams & spread them out
     micros = timerMicros();
     for (i = 0; i < AQMAVLINK_TOTAL_STREAMS; i++) {
@@ -25,6 +25,7 @@
 #include "serial.h"
 #include "digital.h"
 #include "config.h"
+#include "filer.h"
 #include "../mavlink_types.h"
 
 #include <stdint.h>
@@ -43,6 +44,28 @@ extern void mavlinkSendPacket(mavlink_channel_t chan, const uint8_t *buf, uint16
 #define AQMAVLINK_WP_MAX_ATTEMPTS  20      // maximum number of retries for wpnt. requests
 #define AQMAVLINK_DEFAULT_COMP_ID  MAV_COMP_ID_MISSIONPLANNER
 
+// bulk parameter transfer via DATA_TRANSMISSION_HANDSHAKE/ENCAPSULATED_DATA
+#define AQMAVLINK_BULK_PARAM_READ  0xA0      // handshake type, GCS requests all params (width = CRC of blob it has)
+#define AQMAVLINK_BULK_PARAM_WRITE  0xA1      // handshake type, GCS is about to send all params (width = CRC)
+#define AQMAVLINK_BULK_CHUNK   252      // blob bytes per ENCAPSULATED_DATA packet
+#define AQMAVLINK_BULK_INTERVAL  (1e6f / 40.0f)     // 40Hz
+#define AQMAVLINK_BULK_SIZE   (2*sizeof(uint16_t) + CONFIG_NUM_PARAMS*sizeof(float))   // version, count, values by ID
+// log download via LOG_REQUEST_LIST/LOG_REQUEST_DATA
+#define AQMAVLINK_LOG_FNAME   "LOGDL"      // filer handle name
+#define AQMAVLINK_LOG_BUF   512      // size of each of the two read-ahead buffers
+#define AQMAVLINK_LOG_DATA   90      // LOG_DATA payload size
+#define AQMAVLINK_LOG_BURST   4      // max LOG_DATA packets per mavlinkDo() call
+
+// stream scheduling
+#define AQMAVLINK_STREAMS_PER_CYCLE  2      // max streams sent per mavlinkDo() call
+#define AQMAVLINK_LINK_SHARE   0.8f      // fraction of the slowest mavlink serial port's byte rate to use
+#define AQMAVLINK_LINK_RATE_MAX  100000      // bytes/s budget when mavlink only runs over USB/CAN
+#define AQMAVLINK_LINK_BURST   0.05f      // max credit saved up, in seconds of link rate
+#define AQMAVLINK_LINK_SCALE_MIN  0.125f      // lowest budget fraction after repeated tx drops
+#define AQMAVLINK_LINK_RECOVER  1000000      // us between budget increases once drops stop
+
+#define AQMAVLINK_BULK_PACKETS  ((AQMAVLINK_BULK_SIZE + AQMAVLINK_BULK_CHUNK - 1) / AQMAVLINK_BULK_CHUNK)
+
 // this should equal MAV_DATA_STREAM_ENUM_END from mavlink.h
 #define AQMAVLINK_TOTAL_STREAMS   MAV_DATA_STREAM_ENUM_END
 // default stream rates in microseconds
@@ -74,6 +97,8 @@ enum mavlinkCustomDataSets {
     AQMAV_DATASET_DEBUG,
     AQMAV_DATASET_RC,
     AQMAV_DATASET_CONFIG,
+    AQMAV_DATASET_TASKS,
+    AQMAV_DATASET_VIBE,
     AQMAV_DATASET_ENUM_END
 };
 
@@ -89,18 +114,49 @@ typedef struct {
     mavlinkStreams_t streams[AQMAVLINK_TOTAL_STREAMS];
 
     uint32_t nextHeartbeat; // time when to send next heartbeat
+    uint32_t linkRate;  // link budget in bytes/s
+    uint32_t txBytes;  // bytes queued for sending
+    uint32_t txBytesCharged; // txBytes already taken off txCredit
+    uint32_t txDrops;  // comm tx starved/overrun count at last check
+    uint32_t nextScaleUp; // when to next raise txScale
+    int32_t txCredit;  // bytes which may be sent now
+    float txScale;  // fraction of linkRate in use, reduced when comm drops packets
     uint32_t nextParam;  // time when to send next param value
     uint32_t nextWP;  // when to send the next wpt request to planner
+    uint32_t nextBulk;  // when to send next bulk param packet
+    uint32_t bulkRecvd;  // bitmask of bulk param packets received
+    uint8_t *bulkBuf;  // bulk param blob
+
+    // log download
+    filerLogEntry_t *logList; // session logs found by last LOG_REQUEST_LIST
+    uint8_t *logBuf;  // two read-ahead buffers of AQMAVLINK_LOG_BUF bytes
+    uint32_t logBufOfs[2]; // file offset of each read-ahead buffer
+    int32_t logBufLen[2]; // bytes in each buffer, FILER_STATUS_BUSY while being read
+    uint32_t logOfs;  // next LOG_DATA offset
+    uint32_t logEnd;  // end of requested window
+    uint16_t logCount;  // entries in logList
+    uint16_t logId;  // log being downloaded, zero if none
+    uint16_t logListNext; // next LOG_ENTRY to send
+    uint16_t logListEnd; // last LOG_ENTRY to send
+    uint16_t logListStart; // requested LOG_ENTRY range, applied once the scan completes
+    uint16_t logListStop;
+    int8_t logHandle;
+    uint8_t logListing;  // directory scan pending in the filer task
 
     uint16_t currentParam; // keep track of parameter send sequence
     uint16_t packetDrops; // global packet drop counter
+    uint16_t bulkCrc;  // CRC of bulk param blob
+    uint16_t bulkSeq;  // next bulk param packet to send
 
     uint8_t sys_type;  // System type (MAV_TYPE enum)
     uint8_t sys_state;  // System state (MAV_STATE enum)
     uint8_t sys_mode;  // System operating mode (MAV_MODE_FLAG enum bitmask)
 
     uint8_t indexPort;  // current port # in channels outputs sequence
+    uint8_t indexTask;  // current task # in task stats outputs sequence
+    uint8_t indexVibe;  // current channel # in vibration analysis outputs sequence
     uint8_t paramCompId; // component ID to use for params list
+    uint8_t bulkType;  // bulk param transfer in progress, AQMAVLINK_BULK_PARAM_READ/WRITE or zero
 
     // waypoint programming from mission planner
     uint8_t wpTargetSysId;
@@ -19,6 +19,7 @@
 #include "calib.h"
 #include "supervisor.h"
 #include "comm.h"
+#include <string.h>
 #ifndef __CC_ARM
 #include <intrinsics.h>
 #endif
@@ -101,46 +102,137 @@ float32_t calibAngle(float *v1, float *v2) {
     return (fabsf(t-1.0f) < 1e-6f) ? 0.0f : acosf(t);
 }
 
-void calibInsert(float32_t *v) {
-    int idx;
+// one row of the ellipsoid design matrix
+static void calibDesign(float32_t *v, float32_t *d) {
+    d[0] = v[0]*v[0];
+    d[1] = v[1]*v[1];
+    d[2] = v[2]*v[2];
+    d[3] = v[0]*v[1];
+    d[4] = v[0]*v[2];
+    d[5] = v[1]*v[2];
+    d[6] = v[0];
+    d[7] = v[1];
+    d[8] = v[2];
+    d[9] = 1.0f;
+}
+
+// algebraic distance of a sample from the current ellipsoid fit
+static float32_t calibResidual(float32_t *v) {
+    float32_t d[CALIB_N];
+    float32_t e;
     int i;
 
-    idx = calibOctant(v) * CALIB_SAMPLES;
+    calibDesign(v, d);
 
-    for (i = 0; i < CALIB_SAMPLES; i++)
-        if (calibData.calibSamples[(idx + i)*3 + 0] == CALIB_EMPTY_SLOT) {
-            calibData.calibSamples[(idx + i)*3 + 0] = v[0];
-            calibData.calibSamples[(idx + i)*3 + 1] = v[1];
-            calibData.calibSamples[(idx + i)*3 + 2] = v[2];
-            return;
+    e = 0.0f;
+    for (i = 0; i < CALIB_N; i++)
+        e += d[i] * calibData.v[i];
+
+    return e;
+}
+
+// Fold a sample into the upper triangular factor R of the information matrix
+// with Givens rotations, R'R = sum(d*d').  forget < 1 exponentially ages out
+// older samples.
+static void calibFold(float32_t *v, float32_t forget) {
+    float32_t *R = calibData.R;
+    float32_t d[CALIB_N];
+    float32_t r, c, s, t;
+    int i, j;
+
+    calibDesign(v, d);
+
+    if (forget < 1.0f)
+        for (i = 0; i < CALIB_N*CALIB_N; i++)
+            R[i] *= forget;
+
+    for (i = 0; i < CALIB_N; i++) {
+        if (d[i] == 0.0f)
+            continue;
+
+        r = __sqrtf(R[i*CALIB_N + i]*R[i*CALIB_N + i] + d[i]*d[i]);
+        c = R[i*CALIB_N + i] / r;
+        s = d[i] / r;
+
+        R[i*CALIB_N + i] = r;
+        for (j = i+1; j < CALIB_N; j++) {
+            t = R[i*CALIB_N + j];
+            R[i*CALIB_N + j] = c*t + s*d[j];
+            d[j] = c*d[j] - s*t;
         }
+    }
+
+    calibData.numSamples++;
 }
 
-void calibRecalc() {
+static float32_t calibDiag(int i) {
+    float32_t r = calibData.R[i*CALIB_N + i];
+
+    return (fabsf(r) < 1e-12f) ? 1e-12f : r;
+}
+
+// Inverse iteration on R'R, converging calibData.v on the right singular
+// vector of R with the smallest singular value - the ellipsoid fit.
+static void calibIterate(int n) {
+    float32_t *R = calibData.R;
+    float32_t *v = calibData.v;
+    float32_t w[CALIB_N];
+    float32_t t;
     int i, j, k;
 
-    for (i = 0; i < 8; i++) {
-        for (j = 0; j < CALIB_SAMPLES; j++) {
-            k = i*CALIB_SAMPLES + j;
+    for (k = 0; k < n; k++) {
+        // R' * w = v
+        for (i = 0; i < CALIB_N; i++) {
+            t = v[i];
+            for (j = 0; j < i; j++)
+                t -= R[j*CALIB_N + i] * w[j];
+            w[i] = t / calibDiag(i);
+        }
 
-            if (calibData.calibSamples[k*3] != CALIB_EMPTY_SLOT) {
-                if (calibOctant(&calibData.calibSamples[k*3]) != i) {
-                    calibInsert(&calibData.calibSamples[k*3]);
-                    calibData.calibSamples[k*3] = CALIB_EMPTY_SLOT;
-                }
-            }
+        // R * v = w
+        for (i = CALIB_N-1; i >= 0; i--) {
+            t = w[i];
+            for (j = i+1; j < CALIB_N; j++)
+                t -= R[i*CALIB_N + j] * v[j];
+            v[i] = t / calibDiag(i);
         }
+
+        t = 0.0f;
+        for (i = 0; i < CALIB_N; i++)
+            t += v[i]*v[i];
+        t = 1.0f / __sqrtf(t);
+        for (i = 0; i < CALIB_N; i++)
+            v[i] *= t;
     }
 }
 
-int calibCount(void) {
-    int sum;
+// solve the fit from scratch and estimate its rms residual, |R*v|^2 being
+// the sum of squared residuals over the folded samples
+static void calibSolve(void) {
+    float32_t t, e;
     int i, j;
 
+    calibIterate(CALIB_ITERATIONS);
+
+    e = 0.0f;
+    for (i = 0; i < CALIB_N; i++) {
+        t = 0.0f;
+        for (j = i; j < CALIB_N; j++)
+            t += calibData.R[i*CALIB_N + j] * calibData.v[j];
+        e += t*t;
+    }
+
+    calibData.fitError = __sqrtf(e / calibData.numSamples);
+    calibData.fitValid = 1;
+}
+
+static int calibCount(void) {
+    int sum;
+    int i;
+
     sum = 0;
     for (i = 0; i < 8; i++)
-        for (j = 0; j < CALIB_SAMPLES; j++)
-            sum += (calibData.calibSamples[(i*CALIB_SAMPLES + j)*3] != CALIB_EMPTY_SLOT);
+        sum += calibData.octants[i];
 
     calibData.percentComplete = (float32_t)sum / (8*CALIB_SAMPLES) * 100.0f;
 
@@ -148,104 +240,60 @@ int calibCount(void) {
 }
 
 void calibInit(void) {
-    int i, j;
-
-    calibData.calibSamples = (float32_t *)aqCalloc(CALIB_SAMPLES*8*3, sizeof(float32_t));
+    int i;
 
     for (i = 0; i < 3; i++) {
         calibData.min[i] = +999.9;
         calibData.max[i] = -999.9;
     }
 
-    for (i = 0; i < 8; i++)
-        for (j = 0; j < CALIB_SAMPLES; j++)
-            calibData.calibSamples[(i*CALIB_SAMPLES + j)*3] = CALIB_EMPTY_SLOT;
+    memset(calibData.R, 0, sizeof(calibData.R));
+    memset(calibData.octants, 0, sizeof(calibData.octants));
+
+    // start the inverse iteration from a sphere
+    memset(calibData.v, 0, sizeof(calibData.v));
+    calibData.v[0] = calibData.v[1] = calibData.v[2] = 0.5f;
+    calibData.v[9] = -0.5f;
+
+    calibData.numSamples = 0;
+    calibData.fitValid = 0;
+    calibData.fitError = 0.0f;
+    calibData.disturbed = 0;
 
     calibData.lastVec[0] = CALIB_EMPTY_SLOT;
     calibData.percentComplete = 0.0f;
 }
 
-void calibFree(void) {
-    if (calibData.calibSamples) {
-        aqFree(calibData.calibSamples, CALIB_SAMPLES*8*3, sizeof(float32_t));
-        calibData.calibSamples = 0;
-    }
-}
-void calibDeinit(void) {
-    calibFree();
-}
-
-void calibCalculate(void) {
-    arm_matrix_instance_f32 D, R;
+static void calibCalculate(void) {
     float32_t v[3];
     float32_t d, s;
-    float32_t *t;
     float sign;
     int i;
 
-    t = (float32_t *)aqCalloc(10*8*CALIB_SAMPLES, sizeof(float32_t));
-    if (t == 0) {
-        AQ_NOTICE("CALIB: Out of memory\n");
-        goto calibFree;
-    }
-
-    arm_mat_init_f32(&D, 10, 8*CALIB_SAMPLES, t);
-
-    t = calibData.calibSamples;
-    for (i = 0; i < 8*CALIB_SAMPLES; i++) {
-        D.pData[0*8*CALIB_SAMPLES + i] = t[0]*t[0];
-        D.pData[1*8*CALIB_SAMPLES + i] = t[1]*t[1];
-        D.pData[2*8*CALIB_SAMPLES + i] = t[2]*t[2];
-        D.pData[3*8*CALIB_SAMPLES + i] = t[0]*t[1];
-        D.pData[4*8*CALIB_SAMPLES + i] = t[0]*t[2];
-        D.pData[5*8*CALIB_SAMPLES + i] = t[1]*t[2];
-        D.pData[6*8*CALIB_SAMPLES + i] = t[0];
-        D.pData[7*8*CALIB_SAMPLES + i] = t[1];
-        D.pData[8*8*CALIB_SAMPLES + i] = t[2];
-        D.pData[9*8*CALIB_SAMPLES + i] = 1.0f;
-        t += 3;
-    }
-
-    // free raw data
-    calibFree();
+    calibSolve();
 
-    t = (float32_t *)aqCalloc(20*10, sizeof(float32_t));
-    if (t == 0) {
-        AQ_NOTICE("CALIB: Out of memory\n");
-        goto calibFree;
-    }
-
-    arm_mat_init_f32(&R, 20, 10, t);
-    arm_fill_f32(0, t, 20*10);
-
-    if (qrDecompositionT_f32(&D, 0, &R) == 0) {
-        AQ_NOTICE("CALIB: rank deficient - abort\n");
-        goto calibFree;
-    }
-
-    svd(R.pData, calibData.U, 10);
+    sign = (calibData.v[0] < 0.0f) ? -1.0f : +1.0f;
 
-    sign = (R.pData[10*10 + 9] < 0.0f) ? -1.0f : +1.0f;
+    calibData.U[0] = sign * calibData.v[0];
+    calibData.U[1] = sign * calibData.v[3] * 0.5f;
+    calibData.U[2] = sign * calibData.v[4] * 0.5f;
+    calibData.U[3] = sign * calibData.v[3] * 0.5f;
+    calibData.U[4] = sign * calibData.v[1];
+    calibData.U[5] = sign * calibData.v[5] * 0.5f;
+    calibData.U[6] = sign * calibData.v[4] * 0.5f;
+    calibData.U[7] = sign * calibData.v[5] * 0.5f;
+    calibData.U[8] = sign * calibData.v[2];
 
-    calibData.U[0] = sign * R.pData[(10+0)*10 + 9];
-    calibData.U[1] = sign * R.pData[(10+3)*10 + 9] * 0.5f;
-    calibData.U[2] = sign * R.pData[(10+4)*10 + 9] * 0.5f;
-    calibData.U[3] = sign * R.pData[(10+3)*10 + 9] * 0.5f;
-    calibData.U[4] = sign * R.pData[(10+1)*10 + 9];
-    calibData.U[5] = sign * R.pData[(10+5)*10 + 9] * 0.5f;
-    calibData.U[6] = sign * R.pData[(10+4)*10 + 9] * 0.5f;
-    calibData.U[7] = sign * R.pData[(10+5)*10 + 9] * 0.5f;
-    calibData.U[8] = sign * R.pData[(10+2)*10 + 9];
+    calibData.bias[0] = sign * calibData.v[6] * 0.5f;
+    calibData.bias[1] = sign * calibData.v[7] * 0.5f;
+    calibData.bias[2] = sign * calibData.v[8] * 0.5f;
 
-    calibData.bias[0] = sign * R.pData[(10+6)*10 + 9] * 0.5f;
-    calibData.bias[1] = sign * R.pData[(10+7)*10 + 9] * 0.5f;
-    calibData.bias[2] = sign * R.pData[(10+8)*10 + 9] * 0.5f;
-
-    d = sign * R.pData[(10+9)*10 + 9];
+    d = sign * calibData.v[9];
 
     if (cholF(calibData.U) == 0) {
         AQ_NOTICE("CALIB: poor data - abort\n");
-        goto calibFree;
+        calibData.fitValid = 0;
+        return;
     }
 
     solveUT(calibData.U, calibData.bias, v);
@@ -296,13 +344,6 @@ void calibCalculate(void) {
     p[IMU_MAG_ALGN_YZ] = calibData.U[5];
     p[IMU_MAG_ALGN_ZX] = calibData.U[6];
     p[IMU_MAG_ALGN_ZY] = calibData.U[7];
-
-    calibFree:
-
-    if (D.pData)
-        aqFree(D.pData, 10*8*CALIB_SAMPLES, sizeof(float32_t));
-    if (R.pData)
-        aqFree(R.pData, 20*10, sizeof(float32_t));
 }
 
 void calibFinished(void) {
@@ -311,36 +352,37 @@ void calibFinished(void) {
     supervisorDisarm();
 }
 
+// Runs every cycle.  Until there is a fit, samples are collected until every
+// octant is covered, then the fit is solved - and stored in the params if in
+// calibration mode.  After that samples keep being folded in with a forgetting
+// factor, refining the fit, and each reading is checked against it for
+// magnetic disturbances.
 void calibrate(void) {
     float32_t vec[3];
+    float32_t e;
     int i;
+    int calibrating = (supervisorData.state & STATE_CALIBRATION);
+    int collecting = (calibrating || !calibData.fitValid);
 
-    if (!(supervisorData.state & STATE_CALIBRATION))
-        return;
-    /*
-#ifdef USE_DIGITAL_IMU
-    vec[0] = hmc5983Data.rawMag[0];
-    vec[1] = hmc5983Data.rawMag[1];
-    vec[2] = hmc5983Data.rawMag[2];
-#else
-    vec[0] = adcData.voltages[3];
-    vec[1] = adcData.voltages[4];
-    vec[2] = adcData.voltages[5];
-#endif
-    */
     vec[0] = IMU_RAW_MAGX;
     vec[1] = IMU_RAW_MAGY;
     vec[2] = IMU_RAW_MAGZ;
 
-    for (i = 0; i < 3; i++) {
-        if (vec[i] < calibData.min[i])
-            calibData.min[i] = vec[i];
-        if (vec[i] > calibData.max[i])
-            calibData.max[i] = vec[i];
+    if (!collecting) {
+        e = calibResidual(vec);
+        calibData.disturbed = (fabsf(e) > calibData.fitError * CALIB_DISTURB);
+    }
+    else {
+        calibData.disturbed = 0;
 
-        calibData.bias[i] = -(calibData.min[i] + calibData.max[i]) * 0.5f;
+        for (i = 0; i < 3; i++) {
+            if (vec[i] < calibData.min[i])
+                calibData.min[i] = vec[i];
+            if (vec[i] > calibData.max[i])
+                calibData.max[i] = vec[i];
 
-        calibRecalc();
+            calibData.bias[i] = -(calibData.min[i] + calibData.max[i]) * 0.5f;
+        }
     }
 
     if (calibData.lastVec[0] == CALIB_EMPTY_SLOT) {
@@ -349,17 +391,41 @@ void calibrate(void) {
         calibData.lastVec[2] = vec[2];
     }
     else if (calibAngle(calibData.lastVec, vec) * RAD_TO_DEG > CALIB_MIN_ANGLE) {
-        if (fabsf(calibData.min[0] - calibData.max[0]) > 1.0f &&
+        if (!collecting) {
+            // refine in flight, but keep disturbed readings out of the fit
+            if (!calibData.disturbed) {
+                calibFold(vec, CALIB_FORGET);
+                calibIterate(CALIB_REFINE_ITERATIONS);
+
+                e = calibResidual(vec);
+                calibData.fitError = __sqrtf(calibData.fitError*calibData.fitError * (1.0f - CALIB_ERR_ALPHA) + e*e * CALIB_ERR_ALPHA);
+            }
+        }
+        else if (fabsf(calibData.min[0] - calibData.max[0]) > 1.0f &&
                 fabsf(calibData.min[1] - calibData.max[1]) > 1.0f &&
                 fabsf(calibData.min[2] - calibData.max[2]) > 1.0f) {
-            calibInsert(vec);
+            i = calibOctant(vec);
 
-            if (calibCount() == 8 * CALIB_SAMPLES)
-                calibFinished();
+            // a full octant takes no more samples so that none is over weighted
+            if (calibData.octants[i] < CALIB_SAMPLES) {
+                calibFold(vec, 1.0f);
+                calibData.octants[i]++;
+            }
 
-            calibData.lastVec[0] = vec[0];
-            calibData.lastVec[1] = vec[1];
-            calibData.lastVec[2] = vec[2];
+            if (calibCount() == 8 * CALIB_SAMPLES) {
+                if (calibrating)
+                    calibFinished();
+                else
+                    calibSolve();
+                return;
+            }
+        }
+        else {
+            return;
         }
+
+        calibData.lastVec[0] = vec[0];
+        calibData.lastVec[1] = vec[1];
+        calibData.lastVec[2] = vec[2];
     }
 }
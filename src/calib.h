@@ -26,21 +26,32 @@
 #define CALIB_MIN_ANGLE     25      // degrees
 #define CALIB_EMPTY_SLOT    100.0f
 #define CALIB_SCALE     2.0f
+#define CALIB_N             10      // ellipsoid fit parameters
+#define CALIB_ITERATIONS    20      // inverse iterations for a fresh fit
+#define CALIB_REFINE_ITERATIONS 2   // inverse iterations per sample when refining in flight
+#define CALIB_FORGET        0.998f  // R scale per sample folded in flight
+#define CALIB_ERR_ALPHA     0.05f   // fit error filter
+#define CALIB_DISTURB       5.0f    // residual (multiples of fit error) flagged as a disturbance
 
 typedef struct {
-    float32_t *calibSamples;
+    float32_t R[CALIB_N*CALIB_N];   // upper triangular factor of the sample information matrix
+    float32_t v[CALIB_N];           // ellipsoid fit (unit length)
     float32_t lastVec[3];
     float32_t min[3];
     float32_t max[3];
     float32_t bias[3];
     float32_t U[10];
     float32_t percentComplete;
+    float32_t fitError;             // rms algebraic residual of the fit
+    uint32_t numSamples;
+    uint8_t octants[8];             // samples taken per octant
+    uint8_t fitValid;
+    uint8_t disturbed;              // current reading does not fit the ellipsoid
 } calibStruct_t;
 
 extern calibStruct_t calibData;
 
 extern void calibInit(void);
-extern void calibDeinit(void);
 extern void calibrate(void);
 
 #endif
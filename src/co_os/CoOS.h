@@ -133,6 +133,7 @@ extern StatusType  CoActivateTask(OS_TID taskID,void *argv);
 extern StatusType  CoAwakeTask(OS_TID taskID);
 extern StatusType  CoSuspendTask(OS_TID taskID);
 extern StatusType  CoSetPriority(OS_TID taskID,U8 priority);
+extern U8          CoGetTaskPriority(OS_TID taskID);
 extern OS_TID      CreateTask(FUNCPtr task,void *argv,U32 parameter,OS_STK *stk);
 
 /* Implement in file "time.c"      */
@@ -217,6 +218,10 @@ extern void        CoTickToTime(U32 ticks,U8* hour,U8* minute,U8* sec,U16* mills
 /* Implement in file "hook.c"      */
 extern void        CoIdleTask(void* pdata);
 extern void        CoStkOverflowHook(OS_TID taskID);
+#if CFG_TASK_SWITCH_HOOK_EN > 0
+extern void        CoTaskSwitchHook(OS_TID curTaskID,OS_TID nextTaskID);
+extern void        CoTaskReadyHook(OS_TID taskID);
+#endif
 
 
 #endif
@@ -54,11 +54,20 @@ max systerm api call num in ISR.
 */
 #define CFG_MAX_SERVICE_REQUEST (5)
 
+/*!<
+Enable(1) or disable(0) bitmap ready queue schedule.
+If enable(1),CoOS keeps one FIFO per priority plus a ready priority bitmap
+and finds the highest ready priority with CLZ, so insert/remove/schedule are
+constant time. All task priorities must be <= CFG_LOWEST_PRIO.
+*/
+#define CFG_BITMAP_SCHEDULE_EN  (1)
+
 /*!<
 Enable(1) or disable(0) order list schedule.
 If disable(0),CoOS use Binary-Scheduling Algorithm.
+Not used when CFG_BITMAP_SCHEDULE_EN is enabled.
 */
-#if (CFG_MAX_USER_TASKS) <15
+#if (CFG_BITMAP_SCHEDULE_EN > 0) || ((CFG_MAX_USER_TASKS) <15)
 #define CFG_ORDER_LIST_SCHEDULE_EN  (1)
 #else
 #define CFG_ORDER_LIST_SCHEDULE_EN  (0)
@@ -124,6 +133,13 @@ Enable(1) or disable(0) stack overflow checkout .
 */
 #define CFG_STK_CHECKOUT_EN     (0)
 
+/*!<
+Enable(1) or disable(0) task switch hooks.
+If enable(1),CoTaskSwitchHook() is called on every context switch and
+CoTaskReadyHook() whenever a task becomes ready, for run time accounting.
+*/
+#define CFG_TASK_SWITCH_HOOK_EN (1)
+
 
 
 /*---------------------- Memory Management Config ----------------------------*/
@@ -43,6 +43,10 @@ typedef  struct TCB
     U8          state;                  /*!< TaSk status.                     */
     OS_TID      taskID;                 /*!< Task ID.                         */
 
+#if CFG_BITMAP_SCHEDULE_EN > 0
+    U8          rdyPrio;                /*!< PRI of the ready FIFO task is in.*/
+#endif
+
 #if CFG_MUTEX_EN > 0
     OS_MutexID  mutexID;                /*!< Mutex ID.                        */
 #endif
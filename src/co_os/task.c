@@ -39,6 +39,16 @@ OS_TID   RdyTaskPri[CFG_MAX_USER_TASKS+SYS_TASK_NUM] = {0};
 U32      RdyTaskPriInfo[(CFG_MAX_USER_TASKS+SYS_TASK_NUM+31)/32];
 #endif
 
+#if CFG_BITMAP_SCHEDULE_EN > 0
+#define  RDY_PRIO_WORDS      ((CFG_LOWEST_PRIO+32)/32)
+#define  RDY_PRIO_BIT(n)     ((U32)0x80000000 >> ((n)&0x1f))
+
+U32      RdyPrioGrp;                     /*!< Bit n set if RdyPrioMap[n] != 0 */
+U32      RdyPrioMap[RDY_PRIO_WORDS];     /*!< One bit per ready priority,MSB first*/
+P_OSTCB  RdyPrioHead[CFG_LOWEST_PRIO+1]; /*!< Head of ready FIFO per priority */
+P_OSTCB  RdyPrioTail[CFG_LOWEST_PRIO+1]; /*!< Tail of ready FIFO per priority */
+#endif
+
 
 /**
  *******************************************************************************
@@ -354,6 +364,35 @@ void DeleteTaskPri(U8 pri)
 #endif
 
 
+#if CFG_BITMAP_SCHEDULE_EN > 0
+
+/**
+ *******************************************************************************
+ * @brief      Get the highest priority ready task
+ * @param[in]  None
+ * @param[out] None
+ * @retval     Co_NULL        No task is ready.
+ *             Others         Head of the highest priority ready FIFO.
+ *
+ * @par Description
+ * @details    This function is called in bitmap schedule to find the head
+ *             of the READY list with two CLZ lookups.
+ *******************************************************************************
+ */
+static P_OSTCB GetHighestRdyTCB(void)
+{
+    U8 word;
+    if(RdyPrioGrp == 0)
+    {
+        return Co_NULL;
+    }
+    word = __builtin_clz(RdyPrioGrp);
+    return RdyPrioHead[(word<<5) + __builtin_clz(RdyPrioMap[word])];
+}
+
+#endif
+
+
 /**
  *******************************************************************************
  * @brief      Insert a task to the ready list
@@ -377,6 +416,13 @@ void InsertToTCBRdyList(P_OSTCB tcbInsert)
     prio = tcbInsert->prio;             /* Get PRI of inserted task           */
     tcbInsert->state     = TASK_READY;  /* Set task as TASK_READY             */
 
+#if CFG_TASK_SWITCH_HOOK_EN >0
+    if(tcbInsert != TCBRunning)         /* Not a preempted running task?      */
+    {
+        CoTaskReadyHook(tcbInsert->taskID);
+    }
+#endif
+
 #if CFG_ROBIN_EN >0
     ptcb = TCBRunning;
     /* Set schedule time for the same PRI task as TCBRunning.                 */
@@ -396,7 +442,32 @@ void InsertToTCBRdyList(P_OSTCB tcbInsert)
 #endif
 
 
-#if CFG_ORDER_LIST_SCHEDULE_EN ==0
+#if CFG_BITMAP_SCHEDULE_EN > 0
+    tcbInsert->rdyPrio = prio;
+    tcbInsert->TCBnext = Co_NULL;
+    ptcb = RdyPrioTail[prio];
+    tcbInsert->TCBprev = ptcb;
+    if(ptcb == Co_NULL)                 /* Is FIFO of this PRI empty?         */
+    {
+        RdyPrioHead[prio]    = tcbInsert; /* Yes,set tcbInsert as FIFO head   */
+        RdyPrioMap[prio>>5] |= RDY_PRIO_BIT(prio);
+        RdyPrioGrp          |= RDY_PRIO_BIT(prio>>5);
+    }
+    else
+    {
+        ptcb->TCBnext = tcbInsert;      /* No,append tcbInsert to FIFO tail   */
+    }
+    RdyPrioTail[prio] = tcbInsert;
+
+    /* Is PRI of inserted task higher than TCBRdy?                            */
+    ptcbNext = TCBRdy;
+    if((ptcbNext == Co_NULL) || (prio < ptcbNext->rdyPrio))
+    {
+        TaskSchedReq = Co_TRUE;
+        TCBRdy       = tcbInsert;       /* Yes,tcbInsert is new READY head    */
+    }
+
+#elif CFG_ORDER_LIST_SCHEDULE_EN ==0
     GetPriSeqNum(prio,&seqNum);
     if(GetPrioSeqNumStatus(seqNum) == Co_TRUE)
     {
@@ -491,6 +562,40 @@ void InsertToTCBRdyList(P_OSTCB tcbInsert)
 void RemoveFromTCBRdyList(P_OSTCB ptcb)
 {
 
+#if CFG_BITMAP_SCHEDULE_EN > 0
+    U8 prio;
+    P_OSTCB pprev,pnext;
+
+    /* PRI may already have been changed by caller,use PRI of the FIFO        */
+    prio  = ptcb->rdyPrio;
+    pprev = ptcb->TCBprev;
+    pnext = ptcb->TCBnext;
+
+    if(pprev == Co_NULL)                   /* Is the head of its FIFO?           */
+        RdyPrioHead[prio] = pnext;
+    else
+        pprev->TCBnext = pnext;
+
+    if(pnext == Co_NULL)                   /* Is the tail of its FIFO?           */
+        RdyPrioTail[prio] = pprev;
+    else
+        pnext->TCBprev = pprev;
+
+    ptcb->TCBnext = Co_NULL;
+    ptcb->TCBprev = Co_NULL;
+
+    if(RdyPrioHead[prio] == Co_NULL)       /* FIFO empty,clear bitmap bits       */
+    {
+        RdyPrioMap[prio>>5] &= ~RDY_PRIO_BIT(prio);
+        if(RdyPrioMap[prio>>5] == 0)
+            RdyPrioGrp &= ~RDY_PRIO_BIT(prio>>5);
+    }
+
+    if(ptcb == TCBRdy)                  /* Removed READY head,find new one    */
+        TCBRdy = GetHighestRdyTCB();
+
+#else
+
 #if CFG_ORDER_LIST_SCHEDULE_EN ==0
     U8 prio;
     U8 seqNum;
@@ -551,6 +656,8 @@ void RemoveFromTCBRdyList(P_OSTCB ptcb)
         SetPrioSeqNumStatus(seqNum, 0);
     }
 #endif
+
+#endif  // CFG_BITMAP_SCHEDULE_EN
 }
 
 
@@ -695,6 +802,24 @@ StatusType CoSetPriority(OS_TID taskID,U8 priority)
 }
 #endif
 
+/**
+ *******************************************************************************
+ * @brief      Get task priority
+ * @param[in]  taskID     Specify task id.
+ * @param[out] None
+ * @retval     Current priority of the task.
+ *
+ * @par Description
+ * @details    This function is called to get the current priority of a task,
+ *             including any priority promotion by a mutex.
+ *******************************************************************************
+ */
+U8 CoGetTaskPriority(OS_TID taskID)
+{
+    return TCBTbl[taskID].prio;
+}
+
+
 /**
  *******************************************************************************
  * @brief      Schedule function
@@ -766,6 +891,10 @@ void Schedule(void)
         CoStkOverflowHook(pCurTcb->taskID);       /* Yes,call handler         */
     }
 #endif
+
+#if CFG_TASK_SWITCH_HOOK_EN > 0
+    CoTaskSwitchHook(pCurTcb->taskID,TCBNext->taskID);
+#endif
     __asm volatile ("cpsid f");
 
     SwitchContext();                              /* Call task context switch */
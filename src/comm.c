@@ -143,6 +143,54 @@ uint8_t commAvailable(commRcvrStruct_t *r) {
     return 0;
 }
 
+// hand out the next contiguous block of received bytes without copying,
+// returns 0 if nothing is waiting.  Release with commRxConsume().
+uint16_t commRxSpan(commRcvrStruct_t *r, uint8_t **buf) {
+    uint8_t port = r->port;
+
+    switch (commData.portTypes[port]) {
+    case COMM_PORT_TYPE_SERIAL:
+        if (commData.portHandles[port])
+            return serialRxSpan(commData.portHandles[port], (volatile unsigned char **)buf);
+        break;
+
+    case COMM_PORT_TYPE_CAN:
+        if (commData.portHandles[port])
+            return canUartRxSpan(commData.portHandles[port], buf);
+        break;
+
+#ifdef HAS_USB
+    case COMM_PORT_TYPE_USB:
+        return usbRxSpan(buf);
+        break;
+#endif
+    }
+
+    return 0;
+}
+
+void commRxConsume(commRcvrStruct_t *r, uint16_t n) {
+    uint8_t port = r->port;
+
+    switch (commData.portTypes[port]) {
+    case COMM_PORT_TYPE_SERIAL:
+        if (commData.portHandles[port])
+            serialRxConsume(commData.portHandles[port], n);
+        break;
+
+    case COMM_PORT_TYPE_CAN:
+        if (commData.portHandles[port])
+            canUartRxConsume(commData.portHandles[port], n);
+        break;
+
+#ifdef HAS_USB
+    case COMM_PORT_TYPE_USB:
+        usbRxConsume(n);
+        break;
+#endif
+    }
+}
+
 // return 0 if none are available
 commTxBuf_t *commGetTxBuf(uint8_t streamType, uint16_t maxSize) {
     commTxBuf_t *txBuf = 0;
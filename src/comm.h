@@ -37,6 +37,7 @@
 #define COMM_NUM_PORTS  7
 #endif
 #define COMM_CAN_PORT   4
+#define COMM_NUM_SERIAL  4      // ports 0-3, configured by COMM_BAUD1-4
 
 #define COMM_DISABLE_FLOW_CONTROL1
 #define COMM_DISABLE_FLOW_CONTROL2
@@ -158,6 +159,8 @@ extern commTxBuf_t *commGetTxBuf(uint8_t streamType, uint16_t maxSize);
 extern void commSendTxBuf(commTxBuf_t *txBuf, uint16_t size);
 extern uint8_t commAvailable(commRcvrStruct_t *r);
 extern uint8_t commReadChar(commRcvrStruct_t *r);
+extern uint16_t commRxSpan(commRcvrStruct_t *r, uint8_t **buf);
+extern void commRxConsume(commRcvrStruct_t *r, uint16_t n);
 extern uint8_t commStreamUsed(uint8_t streamType);
 extern void commTxFinished(void *param);
 extern void commSetStreamType(uint8_t port, uint8_t type);
@@ -126,6 +126,43 @@ static void commandAccIn(commandBufStruct_t *b) {
     commandData.floatDump[9] = dump->values[9];
 }
 
+#ifdef UTIL_TASK_STATS
+// reply with run time statistics of all tasks which have run, optionally reset max values
+static void commandTaskStats(commandBufStruct_t *b) {
+    typedef struct {
+        uint8_t taskId;
+        uint8_t prio;
+        float cpuPercent;
+        uint32_t activations;
+        uint32_t maxRun;
+        uint32_t maxLatency;
+    } __attribute__((packed)) taskStatsReply_t;
+    taskStatsReply_t reply[UTIL_TASK_STATS];
+    utilTaskStats_t *t;
+    uint8_t i, n;
+
+    n = 0;
+    for (i = 0; i < UTIL_TASK_STATS; i++) {
+        t = &utilTaskStatsData.tasks[i];
+        if (!t->activations)
+            continue;
+
+        reply[n].taskId = i;
+        reply[n].prio = CoGetTaskPriority(i);
+        reply[n].cpuPercent = t->cpuPercent;
+        reply[n].activations = t->activations;
+        reply[n].maxRun = t->maxRun;
+        reply[n].maxLatency = t->maxLatency;
+        n++;
+    }
+
+    if (b->data[0])
+        utilTaskStatsResetMax();
+
+    commandAck((char *)reply, n * sizeof(taskStatsReply_t));
+}
+#endif
+
 static void commandExecute(commandBufStruct_t *b) {
     switch (b->commandId) {
     case COMMAND_GPS_PACKET:
@@ -211,6 +248,12 @@ static void commandExecute(commandBufStruct_t *b) {
         commandAccIn(b);
         break;
 
+#ifdef UTIL_TASK_STATS
+    case COMMAND_TASK_STATS:
+        commandTaskStats(b);
+        break;
+#endif
+
     default:
         commandNack(NULL, 0);
         break;
@@ -50,6 +50,7 @@
 #define COMMAND_PID_STOP_DUMP        0x0f
 #define COMMAND_GPS_PACKET           0x10
 #define COMMAND_ACC_IN               0x11
+#define COMMAND_TASK_STATS           0x12
 #define COMMAND_ID_ACK               0xfe
 #define COMMAND_ID_NACK              0xff
 
@@ -39,39 +39,106 @@ configData_t configData CCM_RAM;
 //
 // private functions
 //
-configToken_t *configTokenFindEmpty(void) {
-    configToken_t *p = (configToken_t *)(FLASH_END_ADDR + 1);
+// sort param IDs by name (shell sort, done once at boot)
+static void configBuildNameIndex(void) {
+    uint16_t *idx = configData.nameIndex;
+    uint16_t t;
+    int gap, i, j;
 
-    do {
-        p--;
-    } while (p->key != 0xffffffff);
+    for (i = 0; i < CONFIG_NUM_PARAMS; i++)
+        idx[i] = i;
+
+    for (gap = CONFIG_NUM_PARAMS / 2; gap > 0; gap /= 2) {
+        for (i = gap; i < CONFIG_NUM_PARAMS; i++) {
+            t = idx[i];
+            for (j = i; j >= gap && strncmp(configParamMeta[idx[j - gap]].name, configParamMeta[t].name, CONFIG_PNAME_MAX_LEN) > 0; j -= gap)
+                idx[j] = idx[j - gap];
+            idx[j] = t;
+        }
+    }
+}
+
+// config flash sector is a journal: a header followed by records appended
+// upwards. Only a full sector is erased, at which point the latest copy of
+// every param and token is written back (compaction).
+#define CONFIG_STORE_WORDS       ((FLASH_END_ADDR + 1 - FLASH_START_ADDR) / sizeof(uint32_t))
+#define CONFIG_STORE_PARAM_WORDS (sizeof(configRec_t) / sizeof(uint32_t))
+#define CONFIG_STORE_TOKEN_WORDS (sizeof(configToken_t) / sizeof(uint32_t))
+#define configStoreAddr(off)     ((uint32_t *)flashStartAddr() + (off))
+
+#define configSetDirty(id)       (configData.dirty[(id) >> 5] |= (1UL << ((id) & 31)))
+#define configIsDirty(id)        (configData.dirty[(id) >> 5] & (1UL << ((id) & 31)))
+
+static uint16_t configStoreCheck(uint16_t id, uint32_t *data, int words) {
+    uint8_t *c = (uint8_t *)data;
+    uint8_t ckA, ckB;
+    int i;
+
+    ckA = id;
+    ckB = ckA;
+    ckA += id >> 8;
+    ckB += ckA;
+
+    for (i = 0; i < words * sizeof(uint32_t); i++) {
+        ckA += c[i];
+        ckB += ckA;
+    }
 
-    return p;
+    return ckA | (ckB << 8);
 }
 
-// public
-void configTokenStore(configToken_t *token) {
-    flashAddress((uint32_t)configTokenFindEmpty(), (uint32_t *)token, sizeof(configToken_t)/sizeof(uint32_t));
+// IDs past the current param list still size as params, they may come from
+// another firmware version and are re-mapped by name when indexed
+static int configStoreRecWords(uint16_t id) {
+    if (id < CONFIG_STORE_ID_COMMIT)
+        return CONFIG_STORE_PARAM_WORDS;
+    else if (id == CONFIG_STORE_ID_TOKEN)
+        return CONFIG_STORE_TOKEN_WORDS;
+    else if (id == CONFIG_STORE_ID_COMMIT)
+        return 0;
+    else
+        return -1;
 }
 
-// public
-configToken_t *configTokenGet(uint32_t key) {
-    configToken_t *p, *t;
+// index slot for a token key, 0xff if there's no room for another key
+static uint8_t configStoreTokenSlot(uint32_t key) {
+    configToken_t *t;
+    uint8_t i;
 
-    p = (configToken_t *)(FLASH_END_ADDR + 1);
-    t = 0;
+    for (i = 0; i < CONFIG_STORE_MAX_TOKENS; i++) {
+        if (configData.storeToken[i] == CONFIG_STORE_NONE)
+            return i;
+
+        t = (configToken_t *)configStoreAddr(configData.storeToken[i]);
+        if (t->key == key)
+            return i;
+    }
 
-    do {
-        p--;
+    return 0xff;
+}
 
-        if (p->key == key)
-            t = p;
-    } while (p->key != 0xffffffff);
+static void configStoreIndexToken(uint16_t off) {
+    uint8_t slot = configStoreTokenSlot(((configToken_t *)configStoreAddr(off))->key);
 
-    return t;
+    if (slot < CONFIG_STORE_MAX_TOKENS)
+        configData.storeToken[slot] = off;
 }
 
-configToken_t *configTokenIterate(configToken_t *t) {
+// param records carry their name, so IDs from an older param list are re-mapped
+static void configStoreIndexParam(uint16_t id, uint16_t off) {
+    configRec_t *r = (configRec_t *)configStoreAddr(off);
+    int16_t n;
+
+    if (id < CONFIG_NUM_PARAMS && !strncmp(r->name, configParamMeta[id].name, CONFIG_PNAME_MAX_LEN))
+        n = id;
+    else
+        n = configGetParamIdByName(r->name);
+
+    if (n >= 0)
+        configData.storeParam[n] = off;
+}
+
+static configToken_t *configTokenIterate(configToken_t *t) {
     if (t == 0)
         t = (configToken_t *)(FLASH_END_ADDR + 1);
 
@@ -82,87 +149,315 @@ configToken_t *configTokenIterate(configToken_t *t) {
     return 0;
 }
 
-// param storage in flash
-bool configFlashRead(void) {
-    configRec_t *recs;
+// old layout: fixed list of name/value records from the start of the sector, tokens stored downwards from the end
+static void configStoreIndexLegacy(void) {
+    configRec_t *recs = (configRec_t *)flashStartAddr();
+    configToken_t *t;
     int i;
 
+    configData.storeLegacy = 1;
+
     // validate there is a reasonable config version number at start of flash
     float flashVer = *(float *)(flashStartAddr() + CONFIG_PNAME_MAX_LEN);
-    if (isnan(flashVer) || flashVer <= 0 || flashVer > CONFIG_CURRENT_VERSION + 100)
-        return false;
+    if (!isnan(flashVer) && flashVer > 0 && flashVer <= CONFIG_CURRENT_VERSION + 100) {
+        for (i = 0; i < CONFIG_NUM_PARAMS; i++) {
+            // avoid reading past end of populated flash storage
+            if (!memcmp(recs + i, "\xFF", 1))
+                break;
+            configStoreIndexParam(CONFIG_STORE_NONE, (uint32_t *)(recs + i) - configStoreAddr(0));
+        }
+    }
+
+    // newest token is the lowest one
+    t = 0;
+    while ((t = configTokenIterate(t)))
+        configStoreIndexToken((uint32_t *)t - configStoreAddr(0));
+}
 
-    recs = (void *)flashStartAddr();
+// build the RAM index of the config sector, once at boot
+static void configStoreIndex(void) {
+    configStoreHdr_t *hdr = (configStoreHdr_t *)configStoreAddr(0);
+    configStoreRec_t *rec;
+    uint32_t off, commit;
+    int words;
+    int pass;
+
+    memset(configData.storeParam, 0xff, sizeof(configData.storeParam));
+    memset(configData.storeToken, 0xff, sizeof(configData.storeToken));
+    configData.storeLegacy = 0;
+    configData.storeDirty = 0;
+    configData.storeFree = CONFIG_STORE_WORDS;
+
+    if (hdr->magic != CONFIG_STORE_MAGIC) {
+        configStoreIndexLegacy();
+        return;
+    }
 
-    for (i = 0; i < CONFIG_NUM_PARAMS; i++) {
-        // avoid reading past end of populated flash storage
-        if (!memcmp(recs + i, "\xFF", 1))
+    configData.storeErases = hdr->eraseCount;
+
+    // first pass finds the last commit, params written by an interrupted save are ignored
+    commit = 0;
+    for (pass = 0; pass < 2; pass++) {
+        off = sizeof(configStoreHdr_t) / sizeof(uint32_t);
+
+        while (off < CONFIG_STORE_WORDS && *configStoreAddr(off) != 0xffffffff) {
+            rec = (configStoreRec_t *)configStoreAddr(off);
+            words = configStoreRecWords(rec->id);
+
+            if (words < 0 || off + 1 + words > CONFIG_STORE_WORDS) {
+                configData.storeDirty = 1;
+                break;
+            }
+
+            // params past the last commit would be adopted by the next one, compact before appending
+            if (pass == 1 && off > commit && rec->id != CONFIG_STORE_ID_TOKEN && rec->id != CONFIG_STORE_ID_COMMIT)
+                configData.storeDirty = 1;
+
+            if (configStoreCheck(rec->id, configStoreAddr(off + 1), words) == rec->check) {
+                if (pass == 0) {
+                    if (rec->id == CONFIG_STORE_ID_COMMIT)
+                        commit = off;
+                }
+                else if (rec->id == CONFIG_STORE_ID_TOKEN) {
+                    configStoreIndexToken(off + 1);
+                }
+                else if (rec->id != CONFIG_STORE_ID_COMMIT && off < commit) {
+                    configStoreIndexParam(rec->id, off + 1);
+                }
+            }
+
+            off += 1 + words;
+        }
+    }
+
+    configData.storeFree = off;
+
+    // anything past the last record must still be erased
+    for (; off < CONFIG_STORE_WORDS; off++) {
+        if (*configStoreAddr(off) != 0xffffffff) {
+            configData.storeDirty = 1;
             break;
-        configSetParamByName(recs[i].name, recs[i].val);
+        }
     }
+}
 
-    AQ_NOTICE("config: Parameters restored from flash memory.\n");
+static void configStoreFlushCache(void) {
+    // invalidate the flash data cache
+    FLASH_DataCacheCmd(DISABLE);
+    FLASH_DataCacheReset();
+    FLASH_DataCacheCmd(ENABLE);
+}
 
-    return true;
+// append one record, no compaction
+static int configStoreWrite(uint16_t id, void *data, int words) {
+    uint32_t buf[1 + CONFIG_STORE_TOKEN_WORDS];
+    configStoreRec_t *rec = (configStoreRec_t *)buf;
+    uint32_t off = configData.storeFree;
+
+    if (off + 1 + words > CONFIG_STORE_WORDS)
+        return 0;
+
+    rec->id = id;
+    rec->check = configStoreCheck(id, data, words);
+    if (words)
+        memcpy(&buf[1], data, words * sizeof(uint32_t));
+
+    if (!flashAddress((uint32_t)configStoreAddr(off), buf, 1 + words)) {
+        // whatever was half written is skipped when the sector is next compacted
+        configData.storeDirty = 1;
+        return 0;
+    }
+
+    configStoreFlushCache();
+    configData.storeFree = off + 1 + words;
+
+    if (id == CONFIG_STORE_ID_TOKEN)
+        configStoreIndexToken(off + 1);
+
+    return 1;
 }
 
-uint8_t configFlashWrite(void) {
+// erase the sector and write back the latest committed copy of everything
+static int configStoreCompact(void) {
+    configStoreHdr_t hdr;
     configRec_t *recs;
-    uint8_t ret = 0;
+    configToken_t *toks;
+    uint16_t off[CONFIG_STORE_MAX_TOKENS];
+    int ret = 0;
     int i;
 
-    recs = (void *)aqCalloc(CONFIG_NUM_PARAMS, sizeof(configRec_t));
-
-    if (recs) {
-        configToken_t *tr = (configToken_t *)recs;
-        configToken_t *tf = 0;
-
-        // read all tokens
-        do {
-            tf = configTokenIterate(tf);
-
-            // copy to RAM
-            if (tf) {
-                // only one instance per key
-                do {
-                    if (tr->key == 0 || tr->key == tf->key) {
-                        memcpy(tr, tf, sizeof(configToken_t));
-                        break;
-                    }
-                    tr++;
-                } while (1);
-            }
-        } while (tf);
+    recs = (configRec_t *)aqCalloc(CONFIG_NUM_PARAMS, sizeof(configRec_t));
+    toks = (configToken_t *)aqCalloc(CONFIG_STORE_MAX_TOKENS, sizeof(configToken_t));
 
-        ret = flashErase(flashStartAddr(), CONFIG_NUM_PARAMS * sizeof(configRec_t) / sizeof(uint32_t));
+    if (recs && toks) {
+        for (i = 0; i < CONFIG_NUM_PARAMS; i++)
+            if (configData.storeParam[i] != CONFIG_STORE_NONE)
+                memcpy(&recs[i], configStoreAddr(configData.storeParam[i]), sizeof(configRec_t));
 
-        // invalidate the flash data cache
-        FLASH_DataCacheCmd(DISABLE);
-        FLASH_DataCacheReset();
-        FLASH_DataCacheCmd(ENABLE);
+        for (i = 0; i < CONFIG_STORE_MAX_TOKENS; i++)
+            if (configData.storeToken[i] != CONFIG_STORE_NONE)
+                memcpy(&toks[i], configStoreAddr(configData.storeToken[i]), sizeof(configToken_t));
 
-        if (ret) {
-            tr = (configToken_t *)recs;
+        memcpy(off, configData.storeToken, sizeof(off));
+        memset(configData.storeParam, 0xff, sizeof(configData.storeParam));
+        memset(configData.storeToken, 0xff, sizeof(configData.storeToken));
 
-            // copy tokens back to flash
-            while (tr->key)
-                configTokenStore(tr++);
+        ret = flashErase(flashStartAddr(), 1);
+        configStoreFlushCache();
 
-            // create param list in RAM
-            for (i = 0; i < CONFIG_NUM_PARAMS; i++) {
-                strncpy(recs[i].name, configParamMeta[i].name, CONFIG_PNAME_MAX_LEN);
-                recs[i].val = configGetParamValueForSave(i);
+        if (ret) {
+            hdr.magic = CONFIG_STORE_MAGIC;
+            hdr.eraseCount = ++configData.storeErases;
+            ret = flashAddress(flashStartAddr(), (uint32_t *)&hdr, sizeof(hdr) / sizeof(uint32_t));
+            configStoreFlushCache();
+
+            configData.storeFree = sizeof(hdr) / sizeof(uint32_t);
+            configData.storeLegacy = 0;
+            configData.storeDirty = 0;
+
+            for (i = 0; ret && i < CONFIG_STORE_MAX_TOKENS; i++)
+                if (off[i] != CONFIG_STORE_NONE)
+                    ret = configStoreWrite(CONFIG_STORE_ID_TOKEN, &toks[i], CONFIG_STORE_TOKEN_WORDS);
+
+            for (i = 0; ret && i < CONFIG_NUM_PARAMS; i++) {
+                if (recs[i].name[0]) {
+                    ret = configStoreWrite(i, &recs[i], CONFIG_STORE_PARAM_WORDS);
+                    configData.storeParam[i] = configData.storeFree - CONFIG_STORE_PARAM_WORDS;
+                }
             }
 
-            ret = flashAddress(flashStartAddr(), (uint32_t *)recs, CONFIG_NUM_PARAMS*sizeof(configRec_t)/sizeof(uint32_t));
+            if (ret)
+                ret = configStoreWrite(CONFIG_STORE_ID_COMMIT, 0, 0);
         }
+    }
 
+    if (recs)
         aqFree(recs, CONFIG_NUM_PARAMS, sizeof(configRec_t));
+    if (toks)
+        aqFree(toks, CONFIG_STORE_MAX_TOKENS, sizeof(configToken_t));
+
+    return ret;
+}
+
+// make room for a number of words, compacting the sector if needed
+static int configStoreReserve(uint32_t words) {
+    if (configData.storeLegacy || configData.storeDirty || configData.storeFree + words > CONFIG_STORE_WORDS) {
+        if (!configStoreCompact())
+            return 0;
+    }
+
+    return (configData.storeFree + words <= CONFIG_STORE_WORDS);
+}
+
+// public
+void configTokenStore(configToken_t *token) {
+    if (configStoreReserve(1 + CONFIG_STORE_TOKEN_WORDS))
+        configStoreWrite(CONFIG_STORE_ID_TOKEN, token, CONFIG_STORE_TOKEN_WORDS);
+}
+
+// public
+configToken_t *configTokenGet(uint32_t key) {
+    uint8_t slot = configStoreTokenSlot(key);
+
+    if (slot < CONFIG_STORE_MAX_TOKENS && configData.storeToken[slot] != CONFIG_STORE_NONE)
+        return (configToken_t *)configStoreAddr(configData.storeToken[slot]);
+    else
+        return 0;
+}
+
+// param storage in flash
+bool configFlashRead(void) {
+    configRec_t *r;
+    int i;
+
+    // nothing saved yet
+    if (configData.storeParam[CONFIG_VERSION] == CONFIG_STORE_NONE)
+        return false;
+
+    for (i = 0; i < CONFIG_NUM_PARAMS; i++) {
+        if (configData.storeParam[i] != CONFIG_STORE_NONE) {
+            r = (configRec_t *)configStoreAddr(configData.storeParam[i]);
+            configSetParamByID(i, r->val);
+        }
+    }
+
+    AQ_NOTICE("config: Parameters restored from flash memory.\n");
+
+    return true;
+}
+
+// Many places write p[] directly, so besides what the setters flagged
+// also mark any param whose value differs from its stored record.
+static int configStoreMarkChanged(void) {
+    configRec_t *r;
+    int n = 0;
+    int i;
+
+    for (i = 0; i < CONFIG_NUM_PARAMS; i++) {
+        if (!configIsDirty(i)) {
+            if (configData.storeParam[i] == CONFIG_STORE_NONE) {
+                configSetDirty(i);
+            }
+            else {
+                r = (configRec_t *)configStoreAddr(configData.storeParam[i]);
+                if (r->val != configGetParamValueForSave(i))
+                    configSetDirty(i);
+            }
+        }
+
+        if (configIsDirty(i))
+            n++;
+    }
 
-        AQ_NOTICE("config: Parameters saved to flash memory.\n");
+    return n;
+}
+
+// append changed params followed by a commit record
+uint8_t configFlashWrite(void) {
+    configRec_t rec;
+    uint16_t *staged;
+    uint8_t ret = 0;
+    int n, i;
+
+    n = configStoreMarkChanged();
+
+    staged = (uint16_t *)aqCalloc(CONFIG_NUM_PARAMS, sizeof(uint16_t));
+
+    if (staged) {
+        ret = configStoreReserve(n * (1 + CONFIG_STORE_PARAM_WORDS) + 1);
+
+        // compaction above may have moved everything
+        memcpy(staged, configData.storeParam, sizeof(configData.storeParam));
+
+        for (i = 0; ret && i < CONFIG_NUM_PARAMS; i++) {
+            if (!configIsDirty(i))
+                continue;
+
+            memset(&rec, 0, sizeof(rec));
+            strncpy(rec.name, configParamMeta[i].name, CONFIG_PNAME_MAX_LEN);
+            rec.val = configGetParamValueForSave(i);
+
+            ret = configStoreWrite(i, &rec, CONFIG_STORE_PARAM_WORDS);
+            staged[i] = configData.storeFree - CONFIG_STORE_PARAM_WORDS;
+        }
+
+        if (ret)
+            ret = configStoreWrite(CONFIG_STORE_ID_COMMIT, 0, 0);
+
+        // new values only count once committed
+        if (ret) {
+            memcpy(configData.storeParam, staged, sizeof(configData.storeParam));
+            memset(configData.dirty, 0, sizeof(configData.dirty));
+        }
+
+        aqFree(staged, CONFIG_NUM_PARAMS, sizeof(uint16_t));
+    }
+
+    if (ret) {
+        AQ_PRINTF("config: %d parameters saved to flash memory.\n", n);
     }
     else {
-        AQ_NOTICE("config: Error writing params to flash, cannot allocate memory.\n");
+        AQ_NOTICE("config: Error writing params to flash.\n");
     }
 
     return ret;
@@ -263,6 +558,147 @@ int8_t configWriteFile(char *fname) {
     return ret;
 }
 
+// Read binary config from uSD, same return values as configReadFile()
+// Values are copied straight into p[] if written by this param version, otherwise matched by name.
+int8_t configReadBinFile(char *fname) {
+    configBinFileHdr_t hdr;
+    uint8_t *fileBuf;
+    float *vals;
+    char *names;
+    uint32_t size;
+    int8_t fh;
+    int ret;
+    int i;
+
+    if (fname == 0)
+        fname = CONFIG_BIN_FILE_NAME;
+
+    if ((fh = filerGetHandle(fname)) < 0) {
+        AQ_NOTICE("config: cannot get read file handle\n");
+        return -1;
+    }
+
+    ret = filerRead(fh, &hdr, 0, sizeof(hdr));
+    if (ret < FILER_STATUS_OK) {
+        filerClose(fh);
+        if (ret == FILER_STATUS_ERR_FNF) {
+            AQ_PRINTF("config: Params file not found: (%s)", fname);
+            return -1;
+        }
+        AQ_NOTICE("config: Failed to read parameters from local file.");
+        return -2;
+    }
+
+    if (ret != sizeof(hdr) || hdr.magic != CONFIG_BIN_FILE_MAGIC || !hdr.count) {
+        filerClose(fh);
+        AQ_NOTICE("config: Invalid binary params file.\n");
+        return -1;
+    }
+
+    size = hdr.count * (sizeof(float) + CONFIG_PNAME_MAX_LEN);
+
+    if (!(fileBuf = (uint8_t *)aqCalloc(size, sizeof(uint8_t)))) {
+        AQ_NOTICE("config: Error reading from file, cannot allocate memory.\n");
+        filerClose(fh);
+        return -1;
+    }
+
+    ret = filerRead(fh, fileBuf, -1, size);
+    filerClose(fh);
+
+    vals = (float *)fileBuf;
+    names = (char *)(fileBuf + hdr.count * sizeof(float));
+
+    if (ret != size || configStoreCheck(hdr.version, (uint32_t *)fileBuf, size / sizeof(uint32_t)) != hdr.check) {
+        // nothing applied yet, so running params are intact
+        AQ_NOTICE("config: Invalid binary params file.\n");
+        ret = -1;
+    }
+    else {
+        if (hdr.version == CONFIG_CURRENT_VERSION && hdr.count == CONFIG_NUM_PARAMS)
+            memcpy(p, vals, sizeof(p));
+        else
+            for (i = 0; i < hdr.count; i++)
+                configSetParamByName(&names[i * CONFIG_PNAME_MAX_LEN], vals[i]);
+
+        AQ_NOTICE("config: Parameters loaded from local storage file.\n");
+        ret = 0;
+    }
+
+    aqFree(fileBuf, size, sizeof(uint8_t));
+
+    return ret;
+}
+
+// write binary config to uSD
+int8_t configWriteBinFile(char *fname) {
+    configBinFileHdr_t *hdr;
+    uint8_t *buf;
+    float *vals;
+    char *names;
+    uint32_t size;
+    int8_t fh;
+    int8_t ret;
+    int i;
+
+    if (fname == 0)
+        fname = CONFIG_BIN_FILE_NAME;
+
+    if ((fh = filerGetHandle(fname)) < 0) {
+        AQ_NOTICE("config: cannot get write file handle\n");
+        return -1;
+    }
+
+    size = sizeof(configBinFileHdr_t) + CONFIG_NUM_PARAMS * (sizeof(float) + CONFIG_PNAME_MAX_LEN);
+
+    if (!(buf = (uint8_t *)aqCalloc(size, sizeof(uint8_t)))) {
+        AQ_NOTICE("config: Error writing to file, cannot allocate memory.\n");
+        filerClose(fh);
+        return -1;
+    }
+
+    hdr = (configBinFileHdr_t *)buf;
+    vals = (float *)(buf + sizeof(configBinFileHdr_t));
+    names = (char *)(vals + CONFIG_NUM_PARAMS);
+
+    for (i = 0; i < CONFIG_NUM_PARAMS; i++) {
+        vals[i] = configGetParamValueForSave(i);
+        strncpy(&names[i * CONFIG_PNAME_MAX_LEN], configParamMeta[i].name, CONFIG_PNAME_MAX_LEN);
+    }
+
+    hdr->magic = CONFIG_BIN_FILE_MAGIC;
+    hdr->version = CONFIG_CURRENT_VERSION;
+    hdr->count = CONFIG_NUM_PARAMS;
+    hdr->check = configStoreCheck(hdr->version, (uint32_t *)vals, (size - sizeof(configBinFileHdr_t)) / sizeof(uint32_t));
+
+    ret = (filerWrite(fh, buf, -1, size) == size) ? 0 : -1;
+
+    filerClose(fh);
+
+    aqFree(buf, size, sizeof(uint8_t));
+
+    if (ret > -1)
+        AQ_NOTICE("config: Parameters saved to local storage file.\n");
+    else
+        AQ_NOTICE("config: Error writing parameters to file.\n");
+
+    return ret;
+}
+
+// params file on uSD in whichever format CONFIG_FLAGS selects
+static int8_t configReadParamsFile(void) {
+    int8_t ret;
+
+    if ((uint32_t)p[CONFIG_FLAGS] & CONFIG_FLAG_BINARY_FILE) {
+        // fall back to the text file if there's no binary one yet
+        ret = configReadBinFile(0);
+        if (ret != -1)
+            return ret;
+    }
+
+    return configReadFile(0);
+}
+
 void configLoadDefault(bool all) {
     configData.numPossibleAdjParams = 0;
 
@@ -320,18 +756,25 @@ void configParamsLoaded(void) {
 //
 
 int16_t configGetParamIdByName(char *name) {
-    int i;
-
-    for (i = 0; i < CONFIG_NUM_PARAMS; i++)
-        if (!strncmp(name, configParamMeta[i].name, CONFIG_PNAME_MAX_LEN))
-            break;
-
-    if (i < CONFIG_NUM_PARAMS)
-        return i;
-    else {
-        AQ_PRINTF("config: cannot find parmeter '%s'\n", name);
-        return -1;
+    int lo, hi, mid, cmp;
+
+    // binary search of the name index built by configInit()
+    lo = 0;
+    hi = CONFIG_NUM_PARAMS - 1;
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        cmp = strncmp(name, configParamMeta[configData.nameIndex[mid]].name, CONFIG_PNAME_MAX_LEN);
+
+        if (cmp == 0)
+            return configData.nameIndex[mid];
+        else if (cmp < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
     }
+
+    AQ_PRINTF("config: cannot find parmeter '%s'\n", name);
+    return -1;
 }
 
 char *configGetParamName(uint16_t id) {
@@ -427,6 +870,7 @@ bool configSetParamByID(uint16_t id, float value) {
     }
 
     p[id] = value;
+    configSetDirty(id);
     return true;
 }
 
@@ -452,7 +896,7 @@ bool configLoadParamsFromDefault(void) {
 bool configLoadParamsFromFile(void) {
     bool ret = false;
 
-    if (configReadFile(0) > -1) {
+    if (configReadParamsFile() > -1) {
         configParamsLoaded();
         ret = true;
     }
@@ -461,8 +905,10 @@ bool configLoadParamsFromFile(void) {
 
 bool configLoadParamsFromFlash(void) {
     bool ret = configFlashRead();
-    if (ret)
+    if (ret) {
+        memset(configData.dirty, 0, sizeof(configData.dirty));
         configParamsLoaded();
+    }
 
     return ret;
 }
@@ -471,7 +917,9 @@ bool configSaveParamsToFile(void) {
     bool ret = false;
     // never save esc calibration bit to SD card
     p[MOT_ESC_TYPE] = ((uint32_t)p[MOT_ESC_TYPE] & ~(MOT_ESC_TYPE_CALIB_ENABLE));
-    if (configWriteFile(0) > -1)
+    if ((uint32_t)p[CONFIG_FLAGS] & CONFIG_FLAG_BINARY_FILE)
+        ret = (configWriteBinFile(0) > -1);
+    else if (configWriteFile(0) > -1)
         ret = true;
 
     return ret;
@@ -491,6 +939,9 @@ void configInit(void) {
 
     memset((void *)&configData, 0, sizeof(configData));
 
+    configBuildNameIndex();
+    configStoreIndex();
+
     // start with defaults
     configLoadDefault(true);
 
@@ -498,7 +949,7 @@ void configInit(void) {
     configFlashRead();
 
     // try to load any config params from uSD card
-    fileRet = configReadFile(0);
+    fileRet = configReadParamsFile();
     if (fileRet > -1)
         supervisorConfigRead();
     else if (fileRet < -1) {
@@ -515,6 +966,9 @@ void configInit(void) {
 
     // indicate that we have the latest version of everything loaded
     p[CONFIG_VERSION] = CONFIG_CURRENT_VERSION;
+
+    // the next save compares against flash for anything loaded above
+    memset(configData.dirty, 0, sizeof(configData.dirty));
 }
 
 
@@ -610,6 +1064,8 @@ unsigned int configParameterWrite(void *data) {
     paramStruct_t *par = (paramStruct_t *)data;
 
     memcpy((char *)&p[par->paramId], (char *)par->values, par->num * sizeof(float));
+    for (unsigned int i = par->paramId; i < par->paramId + par->num && i < CONFIG_NUM_PARAMS; i++)
+        configSetDirty(i);
 
     return configParameterRead(data);
 }
@@ -24,15 +24,24 @@
 
 #define CONFIG_BIN_MAGIC 0x1927
 
-#define CONFIG_CURRENT_VERSION     132 // !!! NOTE: increment +1 when adding, removing, or modifying the meaning of any param
+#define CONFIG_CURRENT_VERSION     134 // !!! NOTE: increment +1 when adding, removing, or modifying the meaning of any param
 
 #define CONFIG_FILE_NAME     "params.txt"
+#define CONFIG_BIN_FILE_NAME     "params.bin"
+#define CONFIG_BIN_FILE_MAGIC    0x46505141 // "AQPF"
 #define CONFIG_FILE_BUF_SIZE     512
 #define CONFIG_LINE_BUF_SIZE     128
 #define CONFIG_PNAME_MAX_LEN     16
 
 #define CONFIG_MAX_ADJUSTABLE_PARAMS 6  // total number of CONFIG_ADJUST_Pn params
 
+// flash journal
+#define CONFIG_STORE_MAGIC       0x53464341 // "ACFS", first word of a journaled config sector
+#define CONFIG_STORE_MAX_TOKENS  8          // distinct token keys tracked by the index
+#define CONFIG_STORE_NONE        0xffff     // index entry with nothing stored
+#define CONFIG_STORE_ID_COMMIT   0xfffd     // closes a group of param records written by one save
+#define CONFIG_STORE_ID_TOKEN    0xfffe     // record holds a configToken_t
+
 #if BOARD_VERSION == 6 && defined DIMU_VERSION && DIMU_VERSION > 0
     #if DIMU_VERSION == 10
         #include "board_dimu_v1.h"
@@ -329,6 +338,11 @@ enum configParameters {
     IMU_MAG_INCL,
     IMU_MAG_DECL,
     IMU_PRESS_SENSE,
+    IMU_GYO_NOTCH1,
+    IMU_GYO_NOTCH2,
+    IMU_ACC_NOTCH,
+    IMU_NOTCH_Q,
+    IMU_DYN_NOTCH,
     GMBL_PITCH_PORT,
     GMBL_ROLL_PORT,
     GMBL_PWM_MAX_RL,
@@ -433,7 +447,8 @@ enum configParameters {
 
 // bitmasks for CONFIG_FLAGS param
 enum configFlags {
-    CONFIG_FLAG_SAVE_ADJUSTED = 0x01 // save adjusted params values back to flash/SD, true/false
+    CONFIG_FLAG_SAVE_ADJUSTED = 0x01, // save adjusted params values back to flash/SD, true/false
+    CONFIG_FLAG_BINARY_FILE   = 0x02  // use CONFIG_BIN_FILE_NAME instead of the text params file on SD
 };
 
 typedef struct {
@@ -454,6 +469,28 @@ typedef struct {
     float val;
 } configRec_t;
 
+// binary params file header, followed by float values[count] in param ID order
+// and then char names[count][CONFIG_PNAME_MAX_LEN]
+typedef struct {
+    uint32_t magic;
+    uint16_t version;       // CONFIG_CURRENT_VERSION of the writer
+    uint16_t count;
+    uint16_t check;         // fletcher checksum of values and names
+    uint16_t spare;
+} configBinFileHdr_t;
+
+// config sector header, followed by records appended upwards
+typedef struct {
+    uint32_t magic;
+    uint32_t eraseCount;    // number of compactions this sector has seen
+} configStoreHdr_t;
+
+// record header, followed by a configRec_t (params) or configToken_t
+typedef struct {
+    uint16_t id;            // param ID at time of writing or CONFIG_STORE_ID_xxx
+    uint16_t check;         // fletcher checksum of id and payload
+} configStoreRec_t;
+
 typedef struct {
     unsigned int paramId;
     unsigned int num;
@@ -482,6 +519,14 @@ typedef struct {
     uint16_t numPossibleAdjParams;  // track total number of params flagged as adjustable in definitions
     uint8_t paramFlags[CONFIG_NUM_PARAMS]; // track index of a currently adjustable param in the adjustParams[] array
     paramAdjustSpec_t adjustParams[CONFIG_MAX_ADJUSTABLE_PARAMS];  // param adjustment data
+    uint16_t nameIndex[CONFIG_NUM_PARAMS];  // param IDs sorted by name, for configGetParamIdByName()
+    uint16_t storeParam[CONFIG_NUM_PARAMS]; // flash word offset of the latest committed record of each param
+    uint16_t storeToken[CONFIG_STORE_MAX_TOKENS];  // flash word offset of the latest record of each token key
+    uint32_t storeFree;                     // flash word offset of the next free record
+    uint32_t storeErases;
+    uint32_t dirty[(CONFIG_NUM_PARAMS + 31) / 32];  // params changed since last save/load from flash
+    uint8_t storeLegacy;                    // sector still holds the old fixed layout
+    uint8_t storeDirty;                     // unreadable data past the last record, compact before appending
 } configData_t;
 
 extern float p[CONFIG_NUM_PARAMS];
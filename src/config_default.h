@@ -19,6 +19,7 @@
 
 // Misc config bitfield, 24b max.
 //    b0: 1=save adjusted params back to flash/SD; 0=save defined param value
+//    b1: 1=load/save params on SD as binary params.bin; 0=text params.txt
 #define DEFAULT_CONFIG_FLAGS     0
 
 // Remote control adjustable parameters.  24 bits: SSSS_SSSS_CCCC_CCPP_PPPP_PPPP
@@ -249,6 +250,11 @@
 #define DEFAULT_IMU_MAG_INCL     -65.0
 #define DEFAULT_IMU_MAG_DECL     0.0
 #define DEFAULT_IMU_PRESS_SENSE     0.0f  // 0 == sensor #1, 1 == sensor #2, 2 == both
+#define DEFAULT_IMU_GYO_NOTCH1      0.0f  // Hz, center of a static notch on the rate loop gyo, 0 == disabled
+#define DEFAULT_IMU_GYO_NOTCH2      0.0f  // Hz, second static gyo notch, 0 == disabled
+#define DEFAULT_IMU_ACC_NOTCH       0.0f  // Hz, static notch on acc (must be below 100Hz), 0 == disabled
+#define DEFAULT_IMU_NOTCH_Q         2.0f  // notch quality, center frequency / bandwidth
+#define DEFAULT_IMU_DYN_NOTCH       0.0f  // Hz, lowest gyo vibration peak the dynamic notch follows, 0 == disabled
 
 
 #define DEFAULT_GMBL_PITCH_PORT  0  // Gimbal pitch stabilization output port. 0 == disabled
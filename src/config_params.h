@@ -304,6 +304,11 @@ const paramRecordMeta_t configParamMeta[] = {
     {IMU_MAG_INCL, "IMU_MAG_INCL",  117, AQ_TYPE_FLT, 0, -FLT_MAX, FLT_MAX, DEFAULT_IMU_MAG_INCL},
     {IMU_MAG_DECL, "IMU_MAG_DECL",  117, AQ_TYPE_FLT, 0, -FLT_MAX, FLT_MAX, DEFAULT_IMU_MAG_DECL},
     {IMU_PRESS_SENSE, "IMU_PRESS_SENSE", 117, AQ_TYPE_U8, 0, 0,  2,  DEFAULT_IMU_PRESS_SENSE},
+    {IMU_GYO_NOTCH1, "IMU_GYO_NOTCH1",  133, AQ_TYPE_FLT, 0, 0.0f,  1000.0f, DEFAULT_IMU_GYO_NOTCH1},
+    {IMU_GYO_NOTCH2, "IMU_GYO_NOTCH2",  133, AQ_TYPE_FLT, 0, 0.0f,  1000.0f, DEFAULT_IMU_GYO_NOTCH2},
+    {IMU_ACC_NOTCH, "IMU_ACC_NOTCH",  133, AQ_TYPE_FLT, 0, 0.0f,  100.0f,  DEFAULT_IMU_ACC_NOTCH},
+    {IMU_NOTCH_Q,  "IMU_NOTCH_Q",   133, AQ_TYPE_FLT, 0, 0.1f,  20.0f,  DEFAULT_IMU_NOTCH_Q},
+    {IMU_DYN_NOTCH, "IMU_DYN_NOTCH",  134, AQ_TYPE_FLT, 0, 0.0f,  1000.0f, DEFAULT_IMU_DYN_NOTCH},
     {GMBL_PITCH_PORT, "GMBL_PITCH_PORT", 117, AQ_TYPE_S8, 0, 0,  PWM_NUM_PORTS, DEFAULT_GMBL_PITCH_PORT},
     {GMBL_ROLL_PORT, "GMBL_ROLL_PORT", 117, AQ_TYPE_S8, 0, 0,  PWM_NUM_PORTS, DEFAULT_GMBL_ROLL_PORT},
     {GMBL_PWM_MAX_RL, "GMBL_PWM_MAX_RL", 117, AQ_TYPE_FLT, 0, 750.0f,  2500.0f, DEFAULT_GMBL_PWM_MAX_RL},
@@ -52,6 +52,7 @@ void controlTaskCode(void *unused) {
     uint16_t overrides[3];
     float pitch, roll;
     float pitchCommand, rollCommand, ruddCommand;
+    navUkfAttitude_t *att;
 #ifdef HAS_QUATOS
     float quatDesired[4];
     float ratesActual[3];
@@ -68,6 +69,9 @@ void controlTaskCode(void *unused) {
         // wait for work
         CoWaitForSingleFlag(imuData.dRateFlag, 0);
 
+        // use one attitude snapshot for the whole cycle
+        att = &UKF_ATT;
+
         // this needs to be done ASAP with the freshest of data
         if (supervisorData.state & STATE_ARMED) {
             if (RADIO_THROT > p[CTRL_MIN_THROT] || navData.mode > NAV_STATUS_MANUAL) {
@@ -89,7 +93,7 @@ void controlTaskCode(void *unused) {
 
                 // if motors are not yet running, use this heading as hold heading
                 if (motorsData.throttle == 0) {
-                    navData.holdHeading = AQ_YAW;
+                    navData.holdHeading = att->yaw;
                     controlData.yaw = navData.holdHeading;
 
                     // Reset all PIDs
@@ -108,7 +112,7 @@ void controlTaskCode(void *unused) {
 
                 // constrict nav (only) yaw rates
                 yaw = compassDifference(controlData.yaw, navData.holdHeading);
-                yawRateLimits = configGetParamValue(CTRL_NAV_YAW_RT) / 400.0f;
+                yawRateLimits = configGetParamValue(CTRL_NAV_YAW_RT) * AQ_INNER_TIMESTEP;
                 yaw = constrainFloat(yaw, -yawRateLimits, +yawRateLimits);
                 controlData.yaw = compassNormalize(controlData.yaw + yaw);
 
@@ -142,8 +146,8 @@ void controlTaskCode(void *unused) {
                     ratesDesired[2] = ratesDesired[2] * configGetParamValue(CTRL_MAN_YAW_RT) * DEG_TO_RAD * (1.0f / 700.0f);
 
                     // keep up with actual craft heading
-                    controlData.yaw = AQ_YAW;
-                    navData.holdHeading = AQ_YAW;
+                    controlData.yaw = att->yaw;
+                    navData.holdHeading = att->yaw;
 
                     // request override
                     overrides[2] = CONTROL_MIN_YAW_OVERRIDE;
@@ -154,8 +158,8 @@ void controlTaskCode(void *unused) {
                         ratesDesired[2] = 0.0f;
 
                         // follow actual craft heading
-                        controlData.yaw = AQ_YAW;
-                        navData.holdHeading = AQ_YAW;
+                        controlData.yaw = att->yaw;
+                        navData.holdHeading = att->yaw;
 
                         // decrease override timer
                         overrides[2]--;
@@ -174,17 +178,17 @@ void controlTaskCode(void *unused) {
 
                     // reset controller on startup
                     if (motorsData.throttle == 0) {
-                        quatDesired[0] = UKF_Q1;
-                        quatDesired[1] = UKF_Q2;
-                        quatDesired[2] = UKF_Q3;
-                        quatDesired[3] = UKF_Q4;
+                        quatDesired[0] = att->q[0];
+                        quatDesired[1] = att->q[1];
+                        quatDesired[2] = att->q[2];
+                        quatDesired[3] = att->q[3];
                         quatosReset(quatDesired);
                     }
 
                     ratesActual[0] = IMU_DRATEX + UKF_GYO_BIAS_X;
                     ratesActual[1] = IMU_DRATEY + UKF_GYO_BIAS_Y;
                     ratesActual[2] = IMU_DRATEZ + UKF_GYO_BIAS_Z;
-                    quatos(&UKF_Q1, quatDesired, ratesActual, ratesDesired, overrides);
+                    quatos(att->q, quatDesired, ratesActual, ratesDesired, overrides);
 
                     quatosPowerDistribution(throttle);
                     motorsSendThrust();
@@ -203,8 +207,8 @@ void controlTaskCode(void *unused) {
                     controlData.navRollTarget = utilFilter3(controlData.navRollFilter, controlData.navRollTarget);
 
                     // rotate nav's NE frame of reference to our craft's local frame of reference
-                    pitch = controlData.navPitchTarget * navUkfData.yawCos - controlData.navRollTarget * navUkfData.yawSin;
-                    roll  = controlData.navRollTarget * navUkfData.yawCos + controlData.navPitchTarget * navUkfData.yawSin;
+                    pitch = controlData.navPitchTarget * att->yawCos - controlData.navRollTarget * att->yawSin;
+                    roll  = controlData.navRollTarget * att->yawCos + controlData.navPitchTarget * att->yawSin;
 
                     // combine nav & user requests (both are already smoothed)
                     controlData.pitch = pitch + controlData.userPitchTarget;
@@ -212,20 +216,20 @@ void controlTaskCode(void *unused) {
 
                     if (p[CTRL_PID_TYPE] == 0) {
                         // pitch angle
-                        pitchCommand = pidUpdate(controlData.pitchAnglePID, controlData.pitch, AQ_PITCH);
+                        pitchCommand = pidUpdate(controlData.pitchAnglePID, controlData.pitch, att->pitch);
                         // rate
                         pitchCommand += pidUpdate(controlData.pitchRatePID, 0.0f, IMU_DRATEY);
 
                         // roll angle
-                        rollCommand = pidUpdate(controlData.rollAnglePID, controlData.roll, AQ_ROLL);
+                        rollCommand = pidUpdate(controlData.rollAnglePID, controlData.roll, att->roll);
                         // rate
                         rollCommand += pidUpdate(controlData.rollRatePID, 0.0f, IMU_DRATEX);
                     } else if (p[CTRL_PID_TYPE] == 1) {
                         // pitch rate from angle
-                        pitchCommand = pidUpdate(controlData.pitchRatePID, pidUpdate(controlData.pitchAnglePID, controlData.pitch, AQ_PITCH), IMU_DRATEY);
+                        pitchCommand = pidUpdate(controlData.pitchRatePID, pidUpdate(controlData.pitchAnglePID, controlData.pitch, att->pitch), IMU_DRATEY);
 
                         // roll rate from angle
-                        rollCommand = pidUpdate(controlData.rollRatePID, pidUpdate(controlData.rollAnglePID, controlData.roll, AQ_ROLL), IMU_DRATEX);
+                        rollCommand = pidUpdate(controlData.rollRatePID, pidUpdate(controlData.rollAnglePID, controlData.roll, att->roll), IMU_DRATEX);
                     } else {
                         pitchCommand = 0.0f;
                         rollCommand = 0.0f;
@@ -238,7 +242,7 @@ void controlTaskCode(void *unused) {
                         ruddCommand = pidUpdate(controlData.yawRatePID, ratesDesired[2], IMU_DRATEZ);
                     else
                         // seek a 0 deg difference between hold heading and actual yaw
-                        ruddCommand = pidUpdate(controlData.yawRatePID, pidUpdate(controlData.yawAnglePID, 0.0f, compassDifference(controlData.yaw, AQ_YAW)), IMU_DRATEZ);
+                        ruddCommand = pidUpdate(controlData.yawRatePID, pidUpdate(controlData.yawAnglePID, 0.0f, compassDifference(controlData.yaw, att->yaw)), IMU_DRATEZ);
 
                     rollCommand = constrainFloat(rollCommand, -p[CTRL_MAX], p[CTRL_MAX]);
                     pitchCommand = constrainFloat(pitchCommand, -p[CTRL_MAX], p[CTRL_MAX]);
@@ -26,7 +26,7 @@
 #define CONTROL_STACK_SIZE     200     // must be evenly divisible by 8
 #define CONTROL_PRIORITY     5
 
-#define CONTROL_MIN_YAW_OVERRIDE    300     // in cycles (0.75 s)
+#define CONTROL_MIN_YAW_OVERRIDE    ((int)(0.75f / AQ_INNER_TIMESTEP))     // in cycles (0.75 s)
 
 typedef struct {
     OS_TID controlTask;
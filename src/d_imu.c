@@ -361,6 +361,98 @@ void dIMURequestCalibRead(void) {
         dImuData.calibReadWriteFlag = 1;
 }
 
+// coefficients are published through a latch so a lower priority writer
+// can retune the notches without the rate loop seeing a torn set
+static void dIMUPublishNotches(void) {
+    dImuNotchCoef_t c;
+    float *f = dImuData.notchFreq;
+
+    f[0] = p[IMU_GYO_NOTCH1];
+    f[1] = p[IMU_GYO_NOTCH2];
+    f[DIMU_DYN_NOTCH] = dImuData.dynNotchFreq;
+    f[DIMU_GYO_NOTCHES] = p[IMU_ACC_NOTCH];
+    dImuData.notchQ = p[IMU_NOTCH_Q];
+
+    utilBiquadNotch(&c.gyo[0], DIMU_INNER_DT, f[0], dImuData.notchQ);
+    utilBiquadNotch(&c.gyo[1], DIMU_INNER_DT, f[1], dImuData.notchQ);
+    utilBiquadNotch(&c.gyo[DIMU_DYN_NOTCH], DIMU_INNER_DT, f[DIMU_DYN_NOTCH], dImuData.notchQ);
+    utilBiquadNotch(&c.acc, DIMU_OUTER_DT, f[DIMU_GYO_NOTCHES], dImuData.notchQ);
+
+    utilSeqPublish(&dImuData.notchLatch, &c);
+}
+
+// 0 disables the dynamic notch, it moves on the next dIMUCheckNotches()
+void dIMUSetDynamicNotch(float freq) {
+    dImuData.dynNotchFreq = freq;
+}
+
+// the latch's single writer, run from the supervisor so that param changes
+// and the dynamic notch take effect without a reboot
+void dIMUCheckNotches(void) {
+    float *f = dImuData.notchFreq;
+
+    if (f[0] != p[IMU_GYO_NOTCH1] || f[1] != p[IMU_GYO_NOTCH2] || f[DIMU_DYN_NOTCH] != dImuData.dynNotchFreq ||
+            f[DIMU_GYO_NOTCHES] != p[IMU_ACC_NOTCH] || dImuData.notchQ != p[IMU_NOTCH_Q])
+        dIMUPublishNotches();
+}
+
+static void dIMUUpdateNotches(void) {
+    dImuNotchCoef_t c;
+    int i, j;
+
+    if (dImuData.notchLatch.seq != dImuData.notchSeq) {
+        dImuData.notchSeq = dImuData.notchLatch.seq;
+        utilSeqRead(&dImuData.notchLatch, &c);
+
+        // filter state is kept so a moving notch does not glitch the output
+        for (i = 0; i < 3; i++) {
+            for (j = 0; j < DIMU_GYO_NOTCHES; j++)
+                dImuData.gyoNotch[j][i].c = c.gyo[j];
+            dImuData.accNotch[i].c = c.acc;
+        }
+    }
+}
+
+static void dIMUNotchRates(void) {
+    float rate[3];
+    int i, j;
+
+    rate[0] = IMU_DRATEX;
+    rate[1] = IMU_DRATEY;
+    rate[2] = IMU_DRATEZ;
+
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < DIMU_GYO_NOTCHES; j++)
+            rate[i] = utilBiquad(&dImuData.gyoNotch[j][i], rate[i]);
+
+    IMU_DRATEX = rate[0];
+    IMU_DRATEY = rate[1];
+    IMU_DRATEZ = rate[2];
+}
+
+static void dIMUNotchAcc(void) {
+    IMU_ACCX = utilBiquad(&dImuData.accNotch[0], IMU_ACCX);
+    IMU_ACCY = utilBiquad(&dImuData.accNotch[1], IMU_ACCY);
+    IMU_ACCZ = utilBiquad(&dImuData.accNotch[2], IMU_ACCZ);
+}
+
+static void dIMUNotchInit(void) {
+    int i, j;
+
+    utilSeqLatchInit(&dImuData.notchLatch, &dImuData.notchCoef[0], &dImuData.notchCoef[1], sizeof(dImuNotchCoef_t));
+
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < DIMU_GYO_NOTCHES; j++)
+            utilBiquadReset(&dImuData.gyoNotch[j][i]);
+        utilBiquadReset(&dImuData.accNotch[i]);
+    }
+
+    dImuData.dynNotchFreq = 0.0f;
+    dImuData.notchSeq = 0;
+    dIMUPublishNotches();
+    dIMUUpdateNotches();
+}
+
 static void __attribute__((optimize("Os"))) dIMUTaskCode(void *unused) {
     uint32_t loops = 0;
 
@@ -371,6 +463,8 @@ static void __attribute__((optimize("Os"))) dIMUTaskCode(void *unused) {
         if (dImuData.calibReadWriteFlag)
             dIMUReadWriteCalib();
 
+        dIMUUpdateNotches();
+
         // double rate gyo loop
 #ifdef DIMU_HAVE_MPU6000
         mpu6000DrateDecode();
@@ -379,10 +473,11 @@ static void __attribute__((optimize("Os"))) dIMUTaskCode(void *unused) {
         max21100DrateDecode();
 #endif
 
+        dIMUNotchRates();
         imuDImuDRateReady();
 
         // full sensor loop
-        if (!(loops % (DIMU_OUTER_PERIOD/DIMU_INNER_PERIOD))) {
+        if (!(loops % DIMU_INNER_LOOPS)) {
 #ifdef DIMU_HAVE_MPU6000
             mpu6000Decode();
 #endif
@@ -398,6 +493,8 @@ static void __attribute__((optimize("Os"))) dIMUTaskCode(void *unused) {
 #ifdef DIMU_HAVE_MS5611
             ms5611Decode();
 #endif
+            dIMUNotchAcc();
+
             dImuData.lastUpdate = timerMicros();
             imuDImuSensorReady();
 
@@ -478,6 +575,8 @@ void __attribute__((optimize("Os"))) dIMUInit(void) {
     if (mag3110Init() == 0)
         AQ_NOTICE("DIMU: MAG3110 sensor init failed!\n");
 #endif
+    dIMUNotchInit();
+
     dIMUTaskStack = aqStackInit(DIMU_STACK_SIZE, "DIMU");
 
     dImuData.flag = CoCreateFlag(1, 0);
@@ -542,10 +641,12 @@ void __attribute__((optimize("Os"))) dIMUInit(void) {
     ms5611Enable();
 #endif
 
+#ifndef DIMU_INNER_SYNC
     // setup IMU timestep alarm
     dImuData.nextPeriod = DIMU_TIM->CCR2 + DIMU_INNER_PERIOD;
     DIMU_TIM->CCR2 = dImuData.nextPeriod;
     DIMU_TIM->DIER |= TIM_IT_CC2;
+#endif
 
 #ifdef DIMU_HAVE_MPU6000
     mpu6000InitialBias();
@@ -573,6 +674,14 @@ void dIMUSetAlarm1(int32_t us, dIMUCallback_t *callback, int parameter) {
     DIMU_TIM->DIER |= TIM_IT_CC1;
 }
 
+// called from the sensor's SPI completion (interrupt context) when
+// a full inner period of samples has been read
+void dIMUInnerTrigger(void) {
+    CoEnterISR();
+    isr_SetFlag(dImuData.flag);
+    CoExitISR();
+}
+
 void DIMU_ISR(void) {
     // CC2 is used for IMU period timing
     if (TIM_GetITStatus(DIMU_TIM, TIM_IT_CC2) != RESET) {
@@ -24,6 +24,7 @@
 #include "rcc.h"
 #include <CoOS.h>
 
+#include "util.h"
 #include "mpu6000.h"
 #include "eeprom.h"
 #include "hmc5983.h"
@@ -35,11 +36,29 @@
 #define DIMU_PRIORITY     11
 
 #define DIMU_OUTER_PERIOD   5000       // us (200 Hz)
-#define DIMU_INNER_PERIOD   2500       // us (400 Hz)
+#ifndef DIMU_INNER_PERIOD
+#define DIMU_INNER_PERIOD   2500       // us (400 Hz), boards may go down to 500 (2 kHz)
+#endif
+#define DIMU_INNER_LOOPS    (DIMU_OUTER_PERIOD / DIMU_INNER_PERIOD)
 #define DIMU_OUTER_DT     ((float)DIMU_OUTER_PERIOD / 1e6f)
 #define DIMU_INNER_DT     ((float)DIMU_INNER_PERIOD / 1e6f)
 #define DIMU_TEMP_TAU     5.0f
 
+#if DIMU_OUTER_PERIOD % DIMU_INNER_PERIOD
+#error "DIMU_INNER_PERIOD must evenly divide DIMU_OUTER_PERIOD"
+#endif
+
+// whole 8 kHz sensor samples per inner loop
+#if DIMU_INNER_PERIOD < 500 || DIMU_INNER_PERIOD % 125
+#error "DIMU_INNER_PERIOD must be at least 500 and a multiple of 125"
+#endif
+
+// DIMU_INNER_SYNC clocks the inner loop from completed MPU6000 reads instead
+// of the DIMU timer so the rate loop runs in phase with the gyro samples
+#if defined(DIMU_INNER_SYNC) && !defined(DIMU_HAVE_MPU6000)
+#undef DIMU_INNER_SYNC
+#endif
+
 #if BOARD_VERSION == 9 && (BOARD_REVISION == 1 || BOARD_REVISION == 2)
 #define DIMU_TIM        TIM1
 #define DIMU_CLOCK      (rccClocks.PCLK2_Frequency * 2)
@@ -59,8 +78,16 @@
     #define __rev16 __REV16
 #endif
 
+#define DIMU_GYO_NOTCHES    3          // IMU_GYO_NOTCH1, IMU_GYO_NOTCH2 and the dynamic notch
+#define DIMU_DYN_NOTCH      2
+
 typedef void dIMUCallback_t(int);
 
+typedef struct {
+    utilBiquadCoef_t gyo[DIMU_GYO_NOTCHES];
+    utilBiquadCoef_t acc;
+} dImuNotchCoef_t;
+
 typedef struct {
     OS_TID task;
     OS_FlagID flag;
@@ -74,6 +101,15 @@ typedef struct {
     uint16_t nextPeriod;
     volatile uint32_t lastUpdate;
 
+    utilBiquad_t gyoNotch[DIMU_GYO_NOTCHES][3];
+    utilBiquad_t accNotch[3];
+    dImuNotchCoef_t notchCoef[2];
+    utilSeqLatch_t notchLatch;
+    uint32_t notchSeq;
+    volatile float dynNotchFreq;
+    float notchFreq[DIMU_GYO_NOTCHES+1];    // as last published, gyo notches then acc
+    float notchQ;
+
     uint8_t calibReadWriteFlag;  // 0=no request, 1=read request, 2=write request
 } dImuStruct_t;
 
@@ -85,5 +121,8 @@ extern void dIMUCancelAlarm1(void);
 extern void dIMUSetAlarm1(int32_t us, dIMUCallback_t *callback, int parameter);
 extern void dIMURequestCalibWrite(void);
 extern void dIMURequestCalibRead(void);
+extern void dIMUInnerTrigger(void);
+extern void dIMUSetDynamicNotch(float freq);
+extern void dIMUCheckNotches(void);
 
 #endif
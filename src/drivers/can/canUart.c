@@ -36,6 +36,19 @@ uint8_t canUartReadChar(canUartStruct_t *ptr) {
     return c;
 }
 
+uint16_t canUartRxSpan(canUartStruct_t *ptr, uint8_t **buf) {
+    int16_t head = ptr->rxHead;
+    int16_t tail = ptr->rxTail;
+
+    *buf = &ptr->rxBuf[tail];
+
+    return (head >= tail) ? (head - tail) : (CAN_UART_BUF_SIZE - tail);
+}
+
+void canUartRxConsume(canUartStruct_t *ptr, uint16_t n) {
+    ptr->rxTail = (ptr->rxTail + n) % CAN_UART_BUF_SIZE;
+}
+
 void canUartRxChar(uint8_t canId, uint8_t n, uint8_t *data) {
     canUartStruct_t *ptr = &canUartData[canId - 1];
     int i;
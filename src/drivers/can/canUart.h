@@ -40,6 +40,8 @@ typedef struct {
 extern void canUartInit(void);
 extern uint8_t canUartAvailable(canUartStruct_t *ptr);
 extern uint8_t canUartReadChar(canUartStruct_t *ptr);
+extern uint16_t canUartRxSpan(canUartStruct_t *ptr, uint8_t **buf);
+extern void canUartRxConsume(canUartStruct_t *ptr, uint16_t n);
 extern void canUartRxChar(uint8_t canId, uint8_t n, uint8_t *data);
 extern void canUartTxBuf(canUartStruct_t *ptr, uint8_t *buf, uint16_t n, canUartTxCallback_t *callback, void *param);
 extern void canUartStream(void);
@@ -1020,6 +1020,8 @@ void sdioLowLevelInit(void) {
 
     memset((void *)&sdioData, 0, sizeof(sdioData));
 
+    sdioData.sdioFlag = CoCreateFlag(1, 0);
+
     GPIO_PinAFConfig(GPIOC, GPIO_PinSource8, GPIO_AF_SDIO);
     GPIO_PinAFConfig(GPIOC, GPIO_PinSource9, GPIO_AF_SDIO);
     GPIO_PinAFConfig(GPIOC, GPIO_PinSource10, GPIO_AF_SDIO);
@@ -1394,6 +1396,7 @@ SD_Error SD_WriteBlock(uint8_t *writebuff, uint32_t WriteSector, uint16_t BlockS
     sdioData.TransferError = SD_OK;
     sdioData.TransferEnd = 0;
     sdioData.StopCondition = 0;
+    sdioData.writePending = 1;
 
     SDIO->DCTRL = 0x0;
 
@@ -1501,6 +1504,7 @@ SD_Error SD_WriteMultiBlocks(uint8_t *writebuff, uint32_t WriteSector, uint16_t
     sdioData.TransferError = SD_OK;
     sdioData.TransferEnd = 0;
     sdioData.StopCondition = 1;
+    sdioData.writePending = 1;
 
     SDIO->DCTRL = 0x0;
 
@@ -1587,7 +1591,7 @@ SD_Error SD_WaitWriteOperation(void) {
     SD_Error errorstatus = SD_OK;
 
     while (sdioData.TransferEnd == 0 && sdioData.TransferError == SD_OK)
-        yield(1);
+        CoWaitForSingleFlag(sdioData.sdioFlag, SDIO_WAIT_TICKS);
 
     if (sdioData.TransferError != SD_OK)
         return(sdioData.TransferError);
@@ -1604,7 +1608,7 @@ SD_Error SD_WaitReadOperation(void) {
     SD_Error errorstatus = SD_OK;
 
     while (sdioData.TransferEnd == 0 && sdioData.TransferError == SD_OK)
-        yield(1);
+        CoWaitForSingleFlag(sdioData.sdioFlag, SDIO_WAIT_TICKS);
 
     if (sdioData.TransferError != SD_OK)
         return(sdioData.TransferError);
@@ -1857,6 +1861,18 @@ SDTransferState SD_GetStatus(void) {
     }
 }
 
+// Wait for the card to leave the programming state after a write.
+// Writes return as soon as the data is clocked out, so this is done
+// before the next command instead of at the end of every disk_write().
+static void sdioWaitCardReady(void) {
+    if (sdioData.writePending) {
+        while (SD_GetStatus() == SD_TRANSFER_BUSY)
+            yield(1);
+
+        sdioData.writePending = 0;
+    }
+}
+
 DWORD get_fattime(void) {
     return rtcGetDateTime();
 }
@@ -1907,6 +1923,8 @@ DRESULT disk_read(
     if (SD_Detect() == SD_NOT_PRESENT)
         return RES_NOTRDY; // No card in the socket
 
+    sdioWaitCardReady();
+
     do {
         if (error != SD_OK) {
             AQ_NOTICE("SDIO WRITE error != SD_OK\n");
@@ -1957,6 +1975,9 @@ DRESULT disk_write (
             sdioData.errCount++;
         }
 
+        // wait for any previous writes to finish
+        sdioWaitCardReady();
+
         if (count > 1)
             error = SD_WriteMultiBlocks((uint8_t *)buff, sector, 512, count);
         else
@@ -1965,10 +1986,6 @@ DRESULT disk_write (
         if (error == SD_OK)
             error = SD_WaitWriteOperation();
 
-        // wait for any previous writes to finish
-        while (SD_GetStatus() == SD_TRANSFER_BUSY)
-            yield(1);
-
         tries++;
     } while (error != SD_OK && tries < SDIO_RETRIES);
 
@@ -1998,8 +2015,8 @@ DRESULT disk_ioctl (
 
     switch (ctrl) {
     case CTRL_SYNC :  // Make sure that no pending write process
-        while (SD_GetStatus() == SD_TRANSFER_BUSY)
-            ;
+        sdioData.writePending = 1;
+        sdioWaitCardReady();
         res = RES_OK;
         break;
 
@@ -2034,6 +2051,17 @@ void sdioSetCallback(sdioCallback_t *func, uint32_t param) {
     sdioData.callbackParam = param;
 }
 
+// Give up on a transfer whose command was never accepted by the card
+void sdioCancelTransfer(void) {
+    SDIO_ITConfig(SDIO_IT_DCRCFAIL | SDIO_IT_DTIMEOUT | SDIO_IT_DATAEND |
+            SDIO_IT_TXFIFOHE | SDIO_IT_RXFIFOHF | SDIO_IT_TXUNDERR |
+            SDIO_IT_RXOVERR | SDIO_IT_STBITERR, DISABLE);
+
+    sdioData.callbackFunc = 0;
+    sdioData.StopCondition = 0;
+    sdioData.TransferEnd = 1;
+}
+
 void SD_ProcessDMAIRQ(void) {
     DMA_ClearFlag(SDIO_DMA_STREAM, SDIO_DMA_FLAG_FEIF | SDIO_DMA_FLAG_DMEIF | SDIO_DMA_FLAG_TEIF | SDIO_DMA_FLAG_HTIF | SDIO_DMA_FLAG_TCIF);
 
@@ -2079,14 +2107,21 @@ SD_Error SD_ProcessIRQSrc(void) {
     sdioData.TransferEnd = 1;
 
     if (sdioData.callbackFunc) {
-        if (sdioData.TransferError == SD_OK)
-            sdioData.callbackFunc(sdioData.callbackParam);
-        else
-            sdioData.callbackFunc(0);
+        // cleared first as the callback may queue the next transfer
+        sdioCallback_t *func = sdioData.callbackFunc;
 
         sdioData.callbackFunc = 0;
+
+        if (sdioData.TransferError == SD_OK)
+            func(sdioData.callbackParam);
+        else
+            func(0);
     }
 
+    CoEnterISR();
+    isr_SetFlag(sdioData.sdioFlag);
+    CoExitISR();
+
     return (sdioData.TransferError);
 }
 
@@ -21,6 +21,7 @@
 
 #include "digital.h"
 #include "diskio.h"
+#include <CoOS.h>
 
 #ifdef STM32F4_DEFECTS
 // damaged exti pin during solder rework
@@ -31,6 +32,7 @@
 #define SDIO_INIT_CLK_DIV                ((uint8_t)0xB2) // SDIO Intialization Frequency (400KHz max)
 
 #define SDIO_RETRIES   3
+#define SDIO_WAIT_TICKS  2      // flag wait timeout, re-checks transfer state on expiry
 
 // SDIO Commands  Index
 #define SD_CMD_GO_IDLE_STATE                       ((uint8_t)0)
@@ -354,10 +356,13 @@ typedef struct {
     uint32_t errCount;
     sdioCallback_t *callbackFunc;
     uint32_t callbackParam;
+    OS_FlagID sdioFlag;
+    volatile uint8_t writePending;  // card may still be programming the last write
 } sdioStruct_t;
 
 extern void sdioLowLevelInit(void);
 extern void sdioSetCallback(sdioCallback_t *func, uint32_t param);
+extern void sdioCancelTransfer(void);
 extern DSTATUS disk_initialize(BYTE drv);
 extern DSTATUS disk_status(BYTE drv);
 extern DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff);
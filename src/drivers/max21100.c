@@ -162,17 +162,23 @@ void max21100DrateDecode(void) {
     }
 }
 
+#define MAX21100_CLIPPED(v)     ((v) >= MAX21100_CLIP || (v) <= -MAX21100_CLIP)
+
 void max21100Decode(void) {
     volatile uint8_t *d = max21100Data.rxBuf;
     int32_t acc[3], temp, gyo[3];
+    int16_t s[6];
+    int accClip, gyoClip;
     float divisor;
-    int i;
+    int i, k;
 
     for (i = 0; i < 3; i++) {
         acc[i] = 0;
         gyo[i] = 0;
     }
     temp = 0;
+    accClip = 0;
+    gyoClip = 0;
 
     divisor = (float)MAX21100_SLOTS;
     for (i = 0; i < MAX21100_SLOTS; i++) {
@@ -183,18 +189,31 @@ void max21100Decode(void) {
             divisor -= 1.0f;
         }
         else {
-            gyo[0] += (int16_t)__rev16(*(uint16_t *)&d[j+1]);
-            gyo[1] += (int16_t)__rev16(*(uint16_t *)&d[j+3]);
-            gyo[2] += (int16_t)__rev16(*(uint16_t *)&d[j+5]);
+            // gyo x, y, z then acc x, y, z
+            for (k = 0; k < 6; k++)
+                s[k] = (int16_t)__rev16(*(uint16_t *)&d[j+1+k*2]);
+
+            gyo[0] += s[0];
+            gyo[1] += s[1];
+            gyo[2] += s[2];
 
-            acc[0] += (int16_t)__rev16(*(uint16_t *)&d[j+7]);
-            acc[1] += (int16_t)__rev16(*(uint16_t *)&d[j+9]);
-            acc[2] += (int16_t)__rev16(*(uint16_t *)&d[j+11]);
+            acc[0] += s[3];
+            acc[1] += s[4];
+            acc[2] += s[5];
+
+            // averaging hides clipping, so look at every sample
+            gyoClip |= MAX21100_CLIPPED(s[0]) | MAX21100_CLIPPED(s[1]) | MAX21100_CLIPPED(s[2]);
+            accClip |= MAX21100_CLIPPED(s[3]) | MAX21100_CLIPPED(s[4]) | MAX21100_CLIPPED(s[5]);
 
             temp += (int16_t)__rev16(*(uint16_t *)&d[j+19]);
         }
     }
 
+    if (accClip)
+        max21100Data.accClips++;
+    if (gyoClip)
+        max21100Data.gyoClips++;
+
     divisor = 1.0f / divisor;
 
     max21100Data.rawTemp = temp * divisor * (1.0f / 255.0f);
@@ -32,9 +32,11 @@
 #define MAX21100_BYTES              21
 #define MAX21100_SLOT_SIZE          ((MAX21100_BYTES+sizeof(int)-1) / sizeof(int) * sizeof(int))
 
+#define MAX21100_CLIP               29500   // raw samples beyond this count as clipped (full scale 30000)
+
 #define MAX21100_SLOTS           80          // 100Hz bandwidth
 #define MAX21100_DRATE_SLOTS_QUATOS (MAX21100_SLOTS * 100.0f * DIMU_INNER_DT * 2.0f) // variable
-#define MAX21100_DRATE_SLOTS_PID 40  // 200Hz
+#define MAX21100_DRATE_SLOTS_PID (MAX21100_SLOTS * DIMU_INNER_PERIOD / 5000)  // first null at half the inner loop rate (200Hz @ 400Hz)
 
 #ifdef HAS_QUATOS
     #define MAX21100_DRATE_SLOTS ((int)p[QUATOS_ENABLE] ? MAX21100_DRATE_SLOTS_QUATOS : MAX21100_DRATE_SLOTS_PID)
@@ -58,6 +60,8 @@ typedef struct {
     volatile float gyo[3];
     volatile float dRateGyo[3];
     volatile uint32_t lastUpdate;
+    volatile uint32_t accClips;         // decodes with a clipped sample
+    volatile uint32_t gyoClips;
     float accSign[3];
     float gyoSign[3];
     uint8_t readReg;
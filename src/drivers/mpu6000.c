@@ -24,6 +24,8 @@
 #include "util.h"
 #include "config.h"
 #include "ext_irq.h"
+#include "d_imu.h"
+#include "vibe.h"
 #ifndef __CC_ARM
 #include <intrinsics.h>
 #endif
@@ -31,7 +33,36 @@
 mpu6000Struct_t mpu6000Data;
 
 static void mpu6000TransferComplete(int unused) {
+#ifdef HAS_VIBE
+    // hand the completed slot to the vibration analysis at full rate while it is capturing
+    if (vibeData.capture) {
+        volatile uint32_t *d = &mpu6000Data.rxBuf[mpu6000Data.slot*MPU6000_SLOT_WORDS];
+        int16_t s[VIBE_CHANNELS];
+        uint32_t w;
+
+        w = __REV16(d[0]);
+        s[0] = w >> 16;
+        w = __REV16(d[1]);
+        s[1] = w;
+        s[2] = w >> 16;
+        w = __REV16(d[2]);
+        s[3] = w >> 16;
+        w = __REV16(d[3]);
+        s[4] = w;
+        s[5] = w >> 16;
+
+        vibeSample(s);
+    }
+#endif
+
     mpu6000Data.slot = (mpu6000Data.slot + 1) % MPU6000_SLOTS;
+
+#ifdef DIMU_INNER_SYNC
+    if (++mpu6000Data.innerCount >= MPU6000_INNER_SLOTS) {
+        mpu6000Data.innerCount = 0;
+        dIMUInnerTrigger();
+    }
+#endif
 }
 
 void mpu6000InitialBias(void) {
@@ -123,49 +154,63 @@ static void mpu6000CalibGyo(float *in, volatile float *out) {
     out[2] = z;
 }
 
+// Sums of the seven channels use the M4's dual 16 bit multiply-accumulate:
+// after __REV16 each slot word holds two native samples, and SMLAD against a
+// mask of 0x0001 / 0x00010000 adds the low or high one to a 32 bit sum.
+// The mask is zero for a slot still being read, which drops it without a branch.
+#define MPU6000_MASK_LO(m)  ((m) & 0x0000ffff)
+#define MPU6000_MASK_HI(m)  ((m) & 0xffff0000)
+
+#define MPU6000_CLIPPED_LO(w)   ((int16_t)(w) >= MPU6000_CLIP || (int16_t)(w) <= -MPU6000_CLIP)
+#define MPU6000_CLIPPED_HI(w)   MPU6000_CLIPPED_LO((w) >> 16)
+
 void mpu6000DrateDecode(void) {
-    volatile uint8_t *d = mpu6000Data.rxBuf;
+    volatile uint32_t *d;
     int32_t gyo[3];
-    float divisor;
+    uint32_t w2, w3, m;
+    int inFlight, n;
     int s, i;
 
     if (mpu6000Data.enabled) {
         for (i = 0; i < 3; i++)
             gyo[i] = 0;
 
-        divisor = (float)MPU6000_DRATE_SLOTS;
+        n = 0;
         s = mpu6000Data.slot - 1;
         if (s < 0)
             s = MPU6000_SLOTS - 1;
 
         for (i = 0; i < MPU6000_DRATE_SLOTS; i++) {
-            int j = s*MPU6000_SLOT_SIZE;
+            d = &mpu6000Data.rxBuf[s*MPU6000_SLOT_WORDS];
 
             // check if we are in the middle of a transaction for this slot
-            if (s == mpu6000Data.slot && mpu6000Data.spiFlag == 0) {
-                divisor -= 1.0f;
-            }
-            else {
-                gyo[0] += (int16_t)__rev16(*(uint16_t *)&d[j+9]);
-                gyo[1] += (int16_t)__rev16(*(uint16_t *)&d[j+11]);
-                gyo[2] += (int16_t)__rev16(*(uint16_t *)&d[j+13]);
-            }
+            inFlight = (mpu6000Data.spiFlag == 0) ? mpu6000Data.slot : -1;
+            m = (s == inFlight) ? 0 : 0x00010001;
+            n += (m != 0);
+
+            w2 = __REV16(d[2]);
+            w3 = __REV16(d[3]);
+
+            gyo[0] = __SMLAD(w2, MPU6000_MASK_HI(m), gyo[0]);
+            gyo[1] = __SMLAD(w3, MPU6000_MASK_LO(m), gyo[1]);
+            gyo[2] = __SMLAD(w3, MPU6000_MASK_HI(m), gyo[2]);
 
             if (--s < 0)
                 s = MPU6000_SLOTS - 1;
         }
 
-        divisor = 1.0f / divisor;
-
-        mpu6000ScaleGyo(gyo, mpu6000Data.dRateRawGyo, divisor);
+        mpu6000ScaleGyo(gyo, mpu6000Data.dRateRawGyo, 1.0f / (float)n);
         mpu6000CalibGyo(mpu6000Data.dRateRawGyo, mpu6000Data.dRateGyo);
     }
 }
 
 void mpu6000Decode(void) {
-    volatile uint8_t *d = mpu6000Data.rxBuf;
+    volatile uint32_t *d = mpu6000Data.rxBuf;
     int32_t acc[3], temp, gyo[3];
+    uint32_t w0, w1, w2, w3, m;
+    int accClip, gyoClip;
     float divisor;
+    int inFlight, n;
     int i;
 
     for (i = 0; i < 3; i++) {
@@ -173,29 +218,45 @@ void mpu6000Decode(void) {
         gyo[i] = 0;
     }
     temp = 0;
+    accClip = 0;
+    gyoClip = 0;
 
-    divisor = (float)MPU6000_SLOTS;
+    n = 0;
     for (i = 0; i < MPU6000_SLOTS; i++) {
-        int j = i*MPU6000_SLOT_SIZE;
-
         // check if we are in the middle of a transaction for this slot
-        if (i == mpu6000Data.slot && mpu6000Data.spiFlag == 0) {
-            divisor -= 1.0f;
-        }
-        else {
-            acc[0] += (int16_t)__rev16(*(uint16_t *)&d[j+1]);
-            acc[1] += (int16_t)__rev16(*(uint16_t *)&d[j+3]);
-            acc[2] += (int16_t)__rev16(*(uint16_t *)&d[j+5]);
-
-            temp += (int16_t)__rev16(*(uint16_t *)&d[j+7]);
-
-            gyo[0] += (int16_t)__rev16(*(uint16_t *)&d[j+9]);
-            gyo[1] += (int16_t)__rev16(*(uint16_t *)&d[j+11]);
-            gyo[2] += (int16_t)__rev16(*(uint16_t *)&d[j+13]);
+        inFlight = (mpu6000Data.spiFlag == 0) ? mpu6000Data.slot : -1;
+        m = (i == inFlight) ? 0 : 0x00010001;
+        n += (m != 0);
+
+        w0 = __REV16(d[0]);
+        w1 = __REV16(d[1]);
+        w2 = __REV16(d[2]);
+        w3 = __REV16(d[3]);
+        d += MPU6000_SLOT_WORDS;
+
+        acc[0] = __SMLAD(w0, MPU6000_MASK_HI(m), acc[0]);
+        acc[1] = __SMLAD(w1, MPU6000_MASK_LO(m), acc[1]);
+        acc[2] = __SMLAD(w1, MPU6000_MASK_HI(m), acc[2]);
+
+        temp = __SMLAD(w2, MPU6000_MASK_LO(m), temp);
+
+        gyo[0] = __SMLAD(w2, MPU6000_MASK_HI(m), gyo[0]);
+        gyo[1] = __SMLAD(w3, MPU6000_MASK_LO(m), gyo[1]);
+        gyo[2] = __SMLAD(w3, MPU6000_MASK_HI(m), gyo[2]);
+
+        // averaging hides clipping, so look at every complete sample
+        if (m) {
+            accClip |= MPU6000_CLIPPED_HI(w0) | MPU6000_CLIPPED_LO(w1) | MPU6000_CLIPPED_HI(w1);
+            gyoClip |= MPU6000_CLIPPED_HI(w2) | MPU6000_CLIPPED_LO(w3) | MPU6000_CLIPPED_HI(w3);
         }
     }
 
-    divisor = 1.0f / divisor;
+    if (accClip)
+        mpu6000Data.accClips++;
+    if (gyoClip)
+        mpu6000Data.gyoClips++;
+
+    divisor = 1.0f / (float)n;
 
     mpu6000Data.rawTemp = temp * divisor * (1.0f / 340.0f) + 36.53f;
     mpu6000Data.temp = utilFilter(&mpu6000Data.tempFilter, mpu6000Data.rawTemp);
@@ -245,7 +306,7 @@ static void mpu6000ReliablySetReg(uint8_t reg, uint8_t val) {
 
 static void mpu6000IntHandler(void) {
     if (mpu6000Data.enabled)
-        spiTransaction(mpu6000Data.spi, &mpu6000Data.rxBuf[mpu6000Data.slot*MPU6000_SLOT_SIZE], &mpu6000Data.readReg, MPU6000_BYTES);
+        spiTransaction(mpu6000Data.spi, (volatile uint8_t *)&mpu6000Data.rxBuf[mpu6000Data.slot*MPU6000_SLOT_WORDS] + MPU6000_SLOT_PAD, &mpu6000Data.readReg, MPU6000_BYTES);
 }
 
 inline void mpu6000Enable(void) {
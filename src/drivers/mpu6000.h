@@ -35,14 +35,23 @@
 #define MPU6000_WRITE_BIT     (0x00<<7)
 
 #define MPU6000_BYTES      15
-#define MPU6000_SLOT_SIZE     ((MPU6000_BYTES+sizeof(int)-1) / sizeof(int) * sizeof(int))
+// each read lands one byte into its slot so that the seven 16 bit samples
+// following the register address byte are halfword aligned, two per word:
+// [pad, reg, accX] [accY, accZ] [temp, gyoX] [gyoY, gyoZ]
+#define MPU6000_SLOT_WORDS     ((MPU6000_BYTES+1+sizeof(int)-1) / sizeof(int))
+#define MPU6000_SLOT_PAD     1
+
+#define MPU6000_CLIP      32000       // raw samples beyond this count as clipped
 
 #ifndef MPU6000_SLOTS
     #define MPU6000_SLOTS     80          // 100Hz bandwidth
 #endif
 
+// samples per inner loop period (8 kHz sample rate)
+#define MPU6000_INNER_SLOTS     (MPU6000_SLOTS * DIMU_INNER_PERIOD / 10000)
+
 #define MPU6000_DRATE_SLOTS_QUATOS (MPU6000_SLOTS * 100.0f * DIMU_INNER_DT * 2.0f) // variable
-#define MPU6000_DRATE_SLOTS_PID  40  // 200Hz
+#define MPU6000_DRATE_SLOTS_PID  (MPU6000_INNER_SLOTS * 2)  // first null at half the inner loop rate (200Hz @ 400Hz)
 
 #ifndef MPU6000_DRATE_SLOTS
     #ifdef HAS_QUATOS
@@ -56,8 +65,9 @@ typedef struct {
     utilFilter_t tempFilter;
     spiClient_t *spi;
     volatile uint32_t spiFlag;
-    volatile uint8_t rxBuf[MPU6000_SLOT_SIZE*MPU6000_SLOTS];
+    volatile uint32_t rxBuf[MPU6000_SLOT_WORDS*MPU6000_SLOTS];
     volatile uint8_t slot;
+    uint8_t innerCount;
     float rawTemp;
     float rawAcc[3];
     float rawGyo[3];
@@ -68,6 +78,8 @@ typedef struct {
     volatile float gyo[3];
     volatile float dRateGyo[3];
     volatile uint32_t lastUpdate;
+    volatile uint32_t accClips;         // decodes with a clipped sample
+    volatile uint32_t gyoClips;
     float accSign[3];
     float gyoSign[3];
     uint8_t readReg;
@@ -744,6 +744,36 @@ int serialRead(serialPort_t *s) {
     return ch;
 }
 
+// contiguous bytes waiting in the rx ring starting at *buf, stops short of the wrap
+unsigned int serialRxSpan(serialPort_t *s, volatile unsigned char **buf) {
+    unsigned int head, tail;
+
+    if (s->rxDMAStream) {
+        head = s->rxBufSize - s->rxDMAStream->NDTR;
+        tail = s->rxBufSize - s->rxPos;
+    }
+    else {
+        head = s->rxHead;
+        tail = s->rxTail;
+    }
+
+    *buf = &s->rxBuf[tail];
+
+    return (head >= tail) ? (head - tail) : (s->rxBufSize - tail);
+}
+
+// release n bytes previously handed out by serialRxSpan()
+void serialRxConsume(serialPort_t *s, unsigned int n) {
+    if (s->rxDMAStream) {
+        s->rxPos -= n;
+        if (s->rxPos == 0)
+            s->rxPos = s->rxBufSize;
+    }
+    else {
+        s->rxTail = (s->rxTail + n) % s->rxBufSize;
+    }
+}
+
 int serialReadBlock(serialPort_t *s) {
     while (!serialAvailable(s))
         yield(1);
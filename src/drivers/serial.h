@@ -65,6 +65,8 @@ extern void serialWatch(void);
 extern unsigned char serialAvailable(serialPort_t *s);
 extern int serialRead(serialPort_t *s);
 extern int serialReadBlock(serialPort_t *s);
+extern unsigned int serialRxSpan(serialPort_t *s, volatile unsigned char **buf);
+extern void serialRxConsume(serialPort_t *s, unsigned int n);
 extern void serialPrint(serialPort_t *s, const char *str);
 extern int _serialStartTxDMA(serialPort_t *s, void *buf, int size, serialTxDMACallback_t *txDMACallback, void *txDMACallbackParam);
 extern int __putchar(int ch);
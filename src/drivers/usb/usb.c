@@ -203,6 +203,19 @@ uint8_t usbRx(void) {
     return ch;
 }
 
+uint16_t usbRxSpan(uint8_t **buf) {
+    uint16_t head = usbData.rxBufHead;
+    uint16_t tail = usbData.rxBufTail;
+
+    *buf = &usbData.rxBuf[tail];
+
+    return (head >= tail) ? (head - tail) : (USB_RX_BUFSIZE - tail);
+}
+
+void usbRxConsume(uint16_t n) {
+    usbData.rxBufTail = (usbData.rxBufTail + n) % USB_RX_BUFSIZE;
+}
+
 uint8_t usbIsSuspend(void) {
     return (USB_OTG_dev.regs.DREGS->DSTS & 1);
 }
@@ -47,6 +47,8 @@ extern void usbInit(void);
 extern void usbTx(uint8_t* buf, uint32_t len);
 extern uint8_t usbRx();
 extern uint8_t usbAvailable(void);
+extern uint16_t usbRxSpan(uint8_t **buf);
+extern void usbRxConsume(uint16_t n);
 extern uint8_t usbIsSuspend(void);
 
 void USBD_USR_Init(void);
@@ -33,6 +33,9 @@
 #include "filer.h"
 
 #define MSC_MEDIA_PACKET  FILER_BUF_SIZE
+#define MSC_MEDIA_HALF    ((MSC_MEDIA_PACKET / 2) & ~511)  // one side of the SD/USB double buffer
+#define MSC_BUSY_RETRIES  250     // SOFs (1ms) the card may refuse a command while programming
+#define MSC_STORAGE_BUSY  1       // storage Read/Write return, card busy, retried on the next SOF
 #define USB_SUPPORT_USER_STRING_DESC
 
 /** @addtogroup USB_OTG_DRIVER
@@ -67,6 +67,7 @@
 #include "usbd_cdc_msc_core.h"
 #include "usbd_msc_mem.h"
 #include "usbd_msc_bot.h"
+#include "usbd_msc_scsi.h"
 #include "usbd_desc.h"
 #include "usbd_req.h"
 #include "filer.h"
@@ -932,6 +933,9 @@ static uint8_t  usbd_cdc_msc_SOF (void *pdev)
 {
   static uint32_t FrameCount = 0;
 
+  /* card transfers refused while the card was busy */
+  SCSI_ProcessRetry();
+
   if (FrameCount++ == CDC_IN_FRAME_INTERVAL)
   {
     /* Reset the frame counter */
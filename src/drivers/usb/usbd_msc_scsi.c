@@ -83,6 +83,20 @@ uint32_t  SCSI_blk_addr;
 uint32_t  SCSI_blk_len;
 
 USB_OTG_CORE_HANDLE  *cdev;
+
+/* Read10/Write10 are pipelined through two halves of MSC_BOT_Data so the
+   SD transfer of one half overlaps the USB transfer of the other.
+   SCSI_blk_addr/len track the USB side, SCSI_sd_addr/len the card side. */
+static uint32_t  SCSI_buf_len[2];     /* bytes held by each half, 0 = free */
+static uint8_t   SCSI_sd_buf;
+static uint8_t   SCSI_usb_buf;
+static uint8_t   SCSI_sd_busy;
+static uint8_t   SCSI_usb_busy;
+static uint8_t   SCSI_pipe_err;
+static uint32_t  SCSI_sd_addr;
+static uint32_t  SCSI_sd_len;
+static int8_t  (*SCSI_sd_retry)(uint8_t lun);  /* kick refused by a busy card */
+static uint16_t  SCSI_sd_retries;
 /**
   * @}
   */
@@ -108,6 +122,9 @@ static int8_t SCSI_CheckAddressRange (uint8_t lun ,
 static int8_t SCSI_ProcessRead (uint8_t lun);
 
 static int8_t SCSI_ProcessWrite (uint8_t lun);
+static void SCSI_PipeReset(void);
+static int8_t SCSI_ReadKick(uint8_t lun);
+static int8_t SCSI_WriteKick(uint8_t lun);
 /**
   * @}
   */
@@ -500,6 +517,8 @@ static int8_t SCSI_Read10(uint8_t lun , uint8_t *params)
                      INVALID_CDB);
       return -1;
     }
+
+    SCSI_PipeReset();
   }
   MSC_BOT_DataLen = MSC_MEDIA_PACKET;
 
@@ -575,10 +594,12 @@ static int8_t SCSI_Write10 (uint8_t lun , uint8_t *params)
 
     /* Prepare EP to receive first data packet */
     MSC_BOT_State = BOT_DATA_OUT;
+    SCSI_PipeReset();
+    SCSI_usb_busy = 1;
     DCD_EP_PrepareRx (cdev,
                       MSC_OUT_EP,
                       MSC_BOT_Data,
-                      MIN (SCSI_blk_len, MSC_MEDIA_PACKET));
+                      MIN (SCSI_blk_len, MSC_MEDIA_HALF));
   }
   else /* Write Process ongoing */
   {
@@ -631,69 +652,192 @@ static int8_t SCSI_CheckAddressRange (uint8_t lun , uint32_t blk_offset , uint16
 }
 
 /**
-* @brief  SCSI_ProcessRead
-*         Handle Read Process
+* @brief  SCSI_PipeReset
+*         Start a new pipelined transfer at SCSI_blk_addr/SCSI_blk_len
+* @retval None
+*/
+static void SCSI_PipeReset(void)
+{
+  SCSI_buf_len[0] = 0;
+  SCSI_buf_len[1] = 0;
+  SCSI_sd_buf = 0;
+  SCSI_usb_buf = 0;
+  SCSI_sd_busy = 0;
+  SCSI_usb_busy = 0;
+  SCSI_pipe_err = 0;
+  SCSI_sd_addr = SCSI_blk_addr;
+  SCSI_sd_len = SCSI_blk_len;
+  SCSI_sd_retry = 0;
+  SCSI_sd_retries = 0;
+}
+
+/**
+* @brief  SCSI_ReadKick
+*         Start whichever side of the read pipeline is idle and has work
 * @param  lun: Logical unit number
 * @retval status
 */
-static int8_t SCSI_ProcessRead (uint8_t lun)
+static int8_t SCSI_ReadKick(uint8_t lun)
 {
   uint32_t len;
+  int8_t ret;
 
-  len = MIN(SCSI_blk_len , MSC_MEDIA_PACKET);
-
-  if( USBD_STORAGE_fops->Read(lun ,
-                              MSC_BOT_Data,
-                              SCSI_blk_addr / SCSI_blk_size,
-                              len / SCSI_blk_size) < 0)
+  /* send a filled half to the host */
+  if (!SCSI_usb_busy && SCSI_buf_len[SCSI_usb_buf])
   {
+    len = SCSI_buf_len[SCSI_usb_buf];
+    SCSI_usb_busy = 1;
 
-    SCSI_SenseCode(lun, HARDWARE_ERROR, UNRECOVERED_READ_ERROR);
-    return -1;
+    SCSI_blk_addr   += len;
+    SCSI_blk_len    -= len;
+
+    /* case 6 : Hi = Di */
+    MSC_BOT_csw.dDataResidue -= len;
+
+    if (SCSI_blk_len == 0)
+    {
+      MSC_BOT_State = BOT_LAST_DATA_IN;
+    }
+
+    DCD_EP_Tx (cdev,
+               MSC_IN_EP,
+               MSC_BOT_Data + SCSI_usb_buf * MSC_MEDIA_HALF,
+               len);
   }
 
-//  DCD_EP_Tx (cdev,
-//             MSC_IN_EP,
-//             MSC_BOT_Data,
-//             len);
-//
-//
-//  SCSI_blk_addr   += len;
-//  SCSI_blk_len    -= len;
-//
-//  /* case 6 : Hi = Di */
-//  MSC_BOT_csw.dDataResidue -= len;
-//
-//  if (SCSI_blk_len == 0)
-//  {
-//    MSC_BOT_State = BOT_LAST_DATA_IN;
-//  }
+  /* and read ahead into the free one */
+  if (!SCSI_sd_busy && SCSI_sd_len && SCSI_buf_len[SCSI_sd_buf] == 0)
+  {
+    len = MIN(SCSI_sd_len , MSC_MEDIA_HALF);
+    SCSI_sd_busy = 1;
+
+    ret = USBD_STORAGE_fops->Read(lun ,
+                                  MSC_BOT_Data + SCSI_sd_buf * MSC_MEDIA_HALF,
+                                  SCSI_sd_addr / SCSI_blk_size,
+                                  len / SCSI_blk_size);
+    if (ret < 0)
+    {
+      SCSI_sd_busy = 0;
+      SCSI_SenseCode(lun, HARDWARE_ERROR, UNRECOVERED_READ_ERROR);
+      return -1;
+    }
+    else if (ret == MSC_STORAGE_BUSY)
+    {
+      SCSI_sd_busy = 0;
+      SCSI_sd_retry = SCSI_ReadKick;
+    }
+    else
+    {
+      SCSI_sd_retries = 0;
+    }
+  }
 
   return 0;
 }
 
+/**
+* @brief  SCSI_ProcessRead
+*         Handle Read Process, called on Read10 and on each IN completion
+* @param  lun: Logical unit number
+* @retval status
+*/
+static int8_t SCSI_ProcessRead (uint8_t lun)
+{
+  if (SCSI_usb_busy)
+  {
+    /* previous half has gone out */
+    SCSI_usb_busy = 0;
+    SCSI_buf_len[SCSI_usb_buf] = 0;
+    SCSI_usb_buf ^= 1;
+  }
+
+  if (SCSI_pipe_err)
+  {
+    return -1;
+  }
+
+  return SCSI_ReadKick(lun);
+}
+
 void SCSI_ProcessReadComplete(uint32_t len) {
-  DCD_EP_Tx (cdev,
-             MSC_IN_EP,
-             MSC_BOT_Data,
-             len);
+  SCSI_sd_busy = 0;
 
+  if (len == 0)
+  {
+    SCSI_SenseCode(MSC_BOT_cbw.bLUN, HARDWARE_ERROR, UNRECOVERED_READ_ERROR);
+    SCSI_pipe_err = 1;
 
-  SCSI_blk_addr   += len;
-  SCSI_blk_len    -= len;
+    /* otherwise reported when the pending IN transfer completes */
+    if (!SCSI_usb_busy)
+    {
+      MSC_BOT_SendCSW (cdev, CSW_CMD_FAILED);
+    }
+    return;
+  }
 
-  /* case 6 : Hi = Di */
-  MSC_BOT_csw.dDataResidue -= len;
+  SCSI_buf_len[SCSI_sd_buf] = len;
+  SCSI_sd_addr += len;
+  SCSI_sd_len  -= len;
+  SCSI_sd_buf ^= 1;
+
+  if (SCSI_ReadKick(MSC_BOT_cbw.bLUN) < 0 && !SCSI_usb_busy)
+  {
+    MSC_BOT_SendCSW (cdev, CSW_CMD_FAILED);
+  }
+}
+
+/**
+* @brief  SCSI_WriteKick
+*         Start whichever side of the write pipeline is idle and has work
+* @param  lun: Logical unit number
+* @retval status
+*/
+static int8_t SCSI_WriteKick(uint8_t lun)
+{
+  int8_t ret;
 
-  if (SCSI_blk_len == 0)
+  /* write a received half to the card */
+  if (!SCSI_sd_busy && SCSI_buf_len[SCSI_sd_buf])
   {
-    MSC_BOT_State = BOT_LAST_DATA_IN;
+    SCSI_sd_busy = 1;
+
+    ret = USBD_STORAGE_fops->Write(lun ,
+                                   MSC_BOT_Data + SCSI_sd_buf * MSC_MEDIA_HALF,
+                                   SCSI_sd_addr / SCSI_blk_size,
+                                   SCSI_buf_len[SCSI_sd_buf] / SCSI_blk_size);
+    if (ret < 0)
+    {
+      SCSI_sd_busy = 0;
+      SCSI_SenseCode(lun, HARDWARE_ERROR, WRITE_FAULT);
+      return -1;
+    }
+    else if (ret == MSC_STORAGE_BUSY)
+    {
+      SCSI_sd_busy = 0;
+      SCSI_sd_retry = SCSI_WriteKick;
+    }
+    else
+    {
+      SCSI_sd_retries = 0;
+    }
   }
+
+  /* and receive the next packet into the free one */
+  if (!SCSI_usb_busy && SCSI_blk_len && SCSI_buf_len[SCSI_usb_buf] == 0)
+  {
+    SCSI_usb_busy = 1;
+    DCD_EP_PrepareRx (cdev,
+                      MSC_OUT_EP,
+                      MSC_BOT_Data + SCSI_usb_buf * MSC_MEDIA_HALF,
+                      MIN (SCSI_blk_len, MSC_MEDIA_HALF));
+  }
+
+  return 0;
 }
 
 /**
 * @brief  SCSI_ProcessWrite
-*         Handle Write Process
+*         Handle Write Process, called on each OUT completion
 * @param  lun: Logical unit number
 * @retval status
 */
@@ -702,57 +846,90 @@ static int8_t SCSI_ProcessWrite (uint8_t lun)
 {
   uint32_t len;
 
-  len = MIN(SCSI_blk_len , MSC_MEDIA_PACKET);
+  len = MIN(SCSI_blk_len , MSC_MEDIA_HALF);
 
-  if(USBD_STORAGE_fops->Write(lun ,
-                              MSC_BOT_Data,
-                              SCSI_blk_addr / SCSI_blk_size,
-                              len / SCSI_blk_size) < 0)
-  {
-    SCSI_SenseCode(lun, HARDWARE_ERROR, WRITE_FAULT);
-    return -1;
-  }
+  SCSI_usb_busy = 0;
+  SCSI_buf_len[SCSI_usb_buf] = len;
+  SCSI_usb_buf ^= 1;
 
-//  SCSI_blk_addr  += len;
-//  SCSI_blk_len   -= len;
-//
-//  /* case 12 : Ho = Do */
-//  MSC_BOT_csw.dDataResidue -= len;
-//
-//  if (SCSI_blk_len == 0)
-//  {
-//    MSC_BOT_SendCSW (cdev, CSW_CMD_PASSED);
-//  }
-//  else
-//  {
-//    /* Prapare EP to Receive next packet */
-//    DCD_EP_PrepareRx (cdev,
-//                      MSC_OUT_EP,
-//                      MSC_BOT_Data,
-//                      MIN (SCSI_blk_len, MSC_MEDIA_PACKET));
-//  }
+  SCSI_blk_addr  += len;
+  SCSI_blk_len   -= len;
 
-  return 0;
+  return SCSI_WriteKick(lun);
 }
 
 void SCSI_ProcessWriteComplete(uint32_t len) {
-  SCSI_blk_addr  += len;
-  SCSI_blk_len   -= len;
+  SCSI_sd_busy = 0;
+
+  if (len == 0)
+  {
+    SCSI_SenseCode(MSC_BOT_cbw.bLUN, HARDWARE_ERROR, WRITE_FAULT);
+    MSC_BOT_SendCSW (cdev, CSW_CMD_FAILED);
+    return;
+  }
 
   /* case 12 : Ho = Do */
   MSC_BOT_csw.dDataResidue -= len;
 
-  if (SCSI_blk_len == 0)
+  SCSI_buf_len[SCSI_sd_buf] = 0;
+  SCSI_sd_buf ^= 1;
+  SCSI_sd_addr += len;
+  SCSI_sd_len  -= len;
+
+  if (SCSI_sd_len == 0)
   {
     MSC_BOT_SendCSW (cdev, CSW_CMD_PASSED);
   }
+  else if (SCSI_WriteKick(MSC_BOT_cbw.bLUN) < 0)
+  {
+    MSC_BOT_SendCSW (cdev, CSW_CMD_FAILED);
+  }
+}
+
+/**
+* @brief  SCSI_ProcessRetry
+*         Called on each SOF, reissue a card transfer refused while busy
+* @retval None
+*/
+void SCSI_ProcessRetry(void)
+{
+  int8_t (*kick)(uint8_t lun) = SCSI_sd_retry;
+  int8_t ret;
+
+  if (kick == 0)
+  {
+    return;
+  }
+
+  SCSI_sd_retry = 0;
+
+  if (++SCSI_sd_retries > MSC_BUSY_RETRIES)
+  {
+    /* card stayed busy too long */
+    SCSI_SenseCode(MSC_BOT_cbw.bLUN, HARDWARE_ERROR, (kick == SCSI_ReadKick) ? UNRECOVERED_READ_ERROR : WRITE_FAULT);
+    ret = -1;
+  }
   else
   {
-    /* Prapare EP to Receive next packet */
-    DCD_EP_PrepareRx (cdev,
-                      MSC_OUT_EP,
-                      MSC_BOT_Data,
-                      MIN (SCSI_blk_len, MSC_MEDIA_PACKET));
+    ret = kick(MSC_BOT_cbw.bLUN);
+  }
+
+  if (ret < 0)
+  {
+    if (kick == SCSI_ReadKick)
+    {
+      SCSI_pipe_err = 1;
+
+      /* otherwise reported when the pending IN transfer completes */
+      if (!SCSI_usb_busy)
+      {
+        MSC_BOT_SendCSW (cdev, CSW_CMD_FAILED);
+      }
+    }
+    else
+    {
+      MSC_BOT_SendCSW (cdev, CSW_CMD_FAILED);
+    }
   }
 }
 /**
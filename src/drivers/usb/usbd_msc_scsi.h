@@ -178,6 +178,7 @@ void   SCSI_SenseCode(uint8_t lun,
 // NEZ
 extern void SCSI_ProcessReadComplete(uint32_t len);
 extern void SCSI_ProcessWriteComplete(uint32_t len);
+extern void SCSI_ProcessRetry(void);
 
 /**
   * @}
@@ -221,8 +221,12 @@ int8_t STORAGE_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_l
 
     sdioSetCallback(SCSI_ProcessReadComplete, blk_len * 512);
 
-    while (SD_ReadMultiBlocks(buf, blk_addr, 512, blk_len) != SD_OK)
- ;
+    // card refuses the command while still programming a previous write,
+    // called from interrupt context so leave the retry to the SCSI layer
+    if (SD_ReadMultiBlocks(buf, blk_addr, 512, blk_len) != SD_OK) {
+ sdioCancelTransfer();
+ return MSC_STORAGE_BUSY;
+    }
 
     return 0;
 }
@@ -241,8 +245,10 @@ int8_t STORAGE_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_
 
     sdioSetCallback(SCSI_ProcessWriteComplete, blk_len * 512);
 
-    while (SD_WriteMultiBlocks(buf, blk_addr, 512, blk_len) != SD_OK)
- ;
+    if (SD_WriteMultiBlocks(buf, blk_addr, 512, blk_len) != SD_OK) {
+ sdioCancelTransfer();
+ return MSC_STORAGE_BUSY;
+    }
 
     return (0);
 }
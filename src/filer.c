@@ -146,6 +146,42 @@ static int32_t filerProcessStream(filerFileStruct_t *f, uint8_t final) {
     return bytes;
 }
 
+static uint8_t filerIsDigit(char c) {
+    return (c >= '0' && c <= '9');
+}
+
+// find session files named NNN-<pattern> in the root directory
+static int32_t filerProcessList(filerFileStruct_t *f) {
+    filerLogEntry_t *list = (filerLogEntry_t *)f->buf;
+    FILINFO fno;
+    DIR dir;
+    uint16_t session;
+    int32_t n = 0;
+
+    if (f_opendir(&dir, "/") != FR_OK)
+        return FILER_STATUS_ERR_OPEN;
+
+    while (n < f->length && f_readdir(&dir, &fno) == FR_OK && fno.fname[0]) {
+        if (fno.fattrib & AM_DIR)
+            continue;
+
+        if (!filerIsDigit(fno.fname[0]) || !filerIsDigit(fno.fname[1]) || !filerIsDigit(fno.fname[2]) || fno.fname[3] != '-' || strcmp(fno.fname + 4, f->pattern))
+            continue;
+
+        session = (fno.fname[0] - '0') * 100 + (fno.fname[1] - '0') * 10 + (fno.fname[2] - '0');
+
+        // skip the session currently being written
+        if (session == filerData.session)
+            continue;
+
+        list[n].session = session;
+        list[n].size = fno.fsize;
+        n++;
+    }
+
+    return n;
+}
+
 static int32_t filerProcessClose(filerFileStruct_t *f) {
     uint32_t res = 0;;
 
@@ -171,6 +207,8 @@ static void filerProcessRequest(filerFileStruct_t *f) {
         f->status = filerProcessSync(f);
     else if (f->function == FILER_FUNC_CLOSE)
         f->status = filerProcessClose(f);
+    else if (f->function == FILER_FUNC_LIST)
+        f->status = filerProcessList(f);
 
     if (f->function != FILER_FUNC_STREAM) {
         f->function = FILER_FUNC_NONE;
@@ -406,6 +444,79 @@ int32_t filerRead(int8_t handle, void *buf, int32_t seek, uint32_t length) {
     return filerReadWrite(&filerData.files[handle], buf, seek, length, FILER_FUNC_READ);
 }
 
+static int32_t filerQueue(filerFileStruct_t *f, void *buf, int32_t seek, uint32_t length, uint8_t function) {
+    // handle allocated yet?
+    if (!f->allocated || !filerData.initialized)
+        return FILER_STATUS_ERR_INIT;
+
+    if (f->function != FILER_FUNC_NONE)
+        return FILER_STATUS_BUSY;
+
+    f->buf = buf;
+    f->seek = seek;
+    f->length = length;
+    f->status = FILER_STATUS_BUSY;
+
+    CoClearFlag(f->completeFlag);
+    f->function = function;
+    CoSetFlag(filerData.filerFlag);
+
+    return FILER_STATUS_OK;
+}
+
+// queue a read and return immediately, check for completion with filerPoll()
+int32_t filerReadAsync(int8_t handle, void *buf, int32_t seek, uint32_t length) {
+    return filerQueue(&filerData.files[handle], buf, seek, length, FILER_FUNC_READ);
+}
+
+// returns FILER_STATUS_BUSY until an asynchronous request completes, then its result
+int32_t filerPoll(int8_t handle) {
+    filerFileStruct_t *f = &filerData.files[handle];
+
+    if (f->function != FILER_FUNC_NONE)
+        return FILER_STATUS_BUSY;
+
+    return f->status;
+}
+
+// queue a directory scan and return immediately, filerPoll() then returns the number of entries found
+int32_t filerListLogsAsync(int8_t handle, const char *pattern, filerLogEntry_t *list, uint16_t max) {
+    filerFileStruct_t *f = &filerData.files[handle];
+
+    if (f->function != FILER_FUNC_NONE)
+        return FILER_STATUS_BUSY;
+
+    f->pattern = pattern;
+
+    return filerQueue(f, list, 0, max, FILER_FUNC_LIST);
+}
+
+// close the current file and point the handle at another one
+int32_t filerSetFileName(int8_t handle, char *fileName) {
+    filerFileStruct_t *f = &filerData.files[handle];
+
+    // handle allocated yet?
+    if (!f->allocated)
+        return FILER_STATUS_ERR_INIT;
+
+    // let any asynchronous request finish
+    if (f->function != FILER_FUNC_NONE)
+        CoWaitForSingleFlag(f->completeFlag, 0);
+
+    f->status = FILER_STATUS_OK;
+    if (f->open) {
+        f->function = FILER_FUNC_CLOSE;
+
+        CoSetFlag(filerData.filerFlag);
+        CoClearFlag(f->completeFlag);
+        CoWaitForSingleFlag(f->completeFlag, 0);
+    }
+
+    strncpy(f->fileName, fileName, sizeof(f->fileName) - 1);
+
+    return f->status;
+}
+
 // no seek if seek == -1
 int32_t filerWrite(int8_t handle, void *buf, int32_t seek, uint32_t length) {
     return filerReadWrite(&filerData.files[handle], buf, seek, length, FILER_FUNC_WRITE);
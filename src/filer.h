@@ -30,6 +30,7 @@
 #define FILER_STREAM_SYNC 200  // ~ 1s
 #define FILER_BUF_SIZE  ((1<<16)-512) // <64KB
 #define FILER_FLUSH_THRESHOLD 4
+#define FILER_MAX_LOGS  64  // max session logs reported by filerListLogsAsync()
 
 #define FILER_FUNC_NONE  0x00
 #define FILER_FUNC_READ  0x01
@@ -37,6 +38,7 @@
 #define FILER_FUNC_STREAM 0x03
 #define FILER_FUNC_SYNC  0x04
 #define FILER_FUNC_CLOSE 0x05
+#define FILER_FUNC_LIST  0x06
 
 enum {
     FILER_STATE_MSC_DISABLE = 0,
@@ -46,6 +48,7 @@ enum {
 };
 
 enum fileReturnStatus {
+    FILER_STATUS_BUSY      = -10, // asynchronous request still pending
     FILER_STATUS_ERR_CLOSE = -9, // error while closing an opened file
     FILER_STATUS_ERR_SYNC  = -8, // synch error on opened file
     FILER_STATUS_ERR_WRITE = -7, // error writing to opened file
@@ -62,6 +65,11 @@ enum fileReturnStatus {
 #define filerEjectMSC()  {filerData.mscState = FILER_STATE_MSC_EJECT;}
 #define filerGetMSCState() (filerData.mscState)
 
+typedef struct {
+    uint16_t session;
+    uint32_t size;
+} filerLogEntry_t;
+
 typedef struct {
     OS_FlagID completeFlag;
 
@@ -70,6 +78,7 @@ typedef struct {
     uint8_t allocated;
 
     char fileName[32];
+    const char *pattern;    // file name suffix for FILER_FUNC_LIST
     FIL fp;
     void *buf;
     int32_t seek;
@@ -100,6 +109,10 @@ extern uint8_t filerBuf[FILER_BUF_SIZE] ;
 extern void filerInit(void);
 extern int8_t filerGetHandle(char *fileName);
 extern int32_t filerRead(int8_t handle, void *buf, int32_t seek, uint32_t length);
+extern int32_t filerReadAsync(int8_t handle, void *buf, int32_t seek, uint32_t length);
+extern int32_t filerPoll(int8_t handle);
+extern int32_t filerListLogsAsync(int8_t handle, const char *pattern, filerLogEntry_t *list, uint16_t max);
+extern int32_t filerSetFileName(int8_t handle, char *fileName);
 extern int32_t filerWrite(int8_t handle, void *buf, int32_t seek, uint32_t length);
 extern int32_t filerStream(int8_t handle, void *buf, uint32_t length);
 extern int32_t filerGetHead(int8_t handle);
@@ -0,0 +1,283 @@
+/*
+    This file is part of AutoQuad.
+
+    AutoQuad is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AutoQuad is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with AutoQuad.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright (c) 2011-2014  Bill Nesbitt
+*/
+
+#include "aq.h"
+#include "health.h"
+#include "imu.h"
+#include "gps.h"
+#include "calib.h"
+#include "canSensors.h"
+#include "comm.h"
+#include "aq_timer.h"
+#include <string.h>
+#include <math.h>
+
+healthStruct_t healthData CCM_RAM;
+
+static const char *healthNames[HEALTH_NUM] = {"GYO", "ACC", "MAG", "PRES", "GPS", "CAN"};
+
+#ifdef IMU_GYO_CLIPS
+#define HEALTH_GYO_CLIPS    IMU_GYO_CLIPS
+#define HEALTH_ACC_CLIPS    IMU_ACC_CLIPS
+#else
+// analog sensors, no clip detection
+#define HEALTH_GYO_CLIPS    0
+#define HEALTH_ACC_CLIPS    0
+#endif
+
+static void healthChannelInit(healthChannel_t *c, uint8_t axes, uint32_t staleTime, float noise) {
+    int i;
+
+    c->axes = axes;
+    c->staleTime = staleTime;
+    c->noise = noise;
+    c->present = 1;
+
+    for (i = 0; i < axes; i++)
+        utilRunStatInit(&c->stat[i], c->hist[i], HEALTH_WINDOW);
+}
+
+// fold in a new reading once per sensor update, then re-evaluate the channel's faults
+static void healthSample(healthChannel_t *c, uint32_t now, uint32_t lastUpdate, float x, float y, float z, uint32_t clips) {
+    float v[3];
+    float std;
+    uint8_t faults = 0;
+    int i;
+
+    if (!c->present) {
+        c->faults = 0;
+        return;
+    }
+
+    if (lastUpdate != c->lastUpdate) {
+        v[0] = x;
+        v[1] = y;
+        v[2] = z;
+
+        if (!c->stat[0].count)
+            c->lastChange = now;
+
+        std = 0.0f;
+        for (i = 0; i < c->axes; i++) {
+            if (v[i] != c->last[i])
+                c->lastChange = now;
+            c->last[i] = v[i];
+
+            utilRunStat(&c->stat[i], v[i]);
+            std += utilRunStatStd(&c->stat[i]);
+        }
+
+        c->lastUpdate = lastUpdate;
+
+        if (c->stat[0].count == HEALTH_WINDOW && std > c->noise)
+            faults |= HEALTH_NOISY;
+    }
+    else {
+        faults = c->faults & HEALTH_NOISY;
+    }
+
+    // the drivers count decodes in which any raw sample clipped
+    if (clips != c->clips) {
+        c->clips = clips;
+        c->lastSat = now;
+    }
+
+    if (c->stat[0].count && (int32_t)(now - c->lastChange) > HEALTH_STUCK_TIME)
+        faults |= HEALTH_STUCK;
+
+    if (c->lastSat && (int32_t)(now - c->lastSat) < HEALTH_SAT_HOLD)
+        faults |= HEALTH_SATURATED;
+
+    c->faults = faults;
+}
+
+// each new fix is checked for accuracy and against the last good one for a
+// jump faster than the craft can move
+static void healthGps(healthChannel_t *c, uint32_t now) {
+    uint32_t posUpdate = gpsData.lastPosUpdate;
+    float dN, dE, d;
+    uint8_t faults;
+    int jumped;
+
+    // no position ever received means no GPS rather than a failed one
+    c->present = (posUpdate != 0);
+    if (!c->present) {
+        c->faults = 0;
+        return;
+    }
+
+    faults = c->faults & HEALTH_POOR;
+
+    if (posUpdate != c->lastUpdate) {
+        c->lastUpdate = posUpdate;
+        faults = 0;
+
+        if (gpsData.hAcc > HEALTH_GPS_HACC || gpsData.noSV < HEALTH_GPS_SATS) {
+            faults |= HEALTH_POOR;
+        }
+        else {
+            jumped = 0;
+            if (healthData.gpsFix) {
+                dN = (float)(gpsData.lat - healthData.gpsLat) * (DEG_TO_RAD * 6378137.0f);
+                dE = (float)(gpsData.lon - healthData.gpsLon) * (DEG_TO_RAD * 6378137.0f) * cosf((float)gpsData.lat * DEG_TO_RAD);
+                d = HEALTH_GPS_SPEED * (float)(posUpdate - healthData.gpsFix) * 1e-6f + 3.0f * gpsData.hAcc;
+
+                if (dN*dN + dE*dE > d*d) {
+                    healthData.gpsJump = now;
+                    jumped = 1;
+                }
+            }
+
+            // a jumped fix is not a reference, the allowance grows until one is accepted
+            if (!jumped) {
+                healthData.gpsLat = gpsData.lat;
+                healthData.gpsLon = gpsData.lon;
+                healthData.gpsFix = posUpdate;
+            }
+        }
+    }
+
+    if (healthData.gpsJump && (int32_t)(now - healthData.gpsJump) < HEALTH_GPS_JUMP_HOLD)
+        faults |= HEALTH_JUMP;
+
+    c->faults = faults;
+}
+
+// run task, every sensor cycle
+void healthCheck(void) {
+    uint32_t now = timerMicros();
+    healthChannel_t *mag = &healthData.chan[HEALTH_MAG];
+
+    healthSample(&healthData.chan[HEALTH_GYO], now, IMU_LASTUPD, IMU_RATEX, IMU_RATEY, IMU_RATEZ, HEALTH_GYO_CLIPS);
+    healthSample(&healthData.chan[HEALTH_ACC], now, IMU_LASTUPD, IMU_ACCX, IMU_ACCY, IMU_ACCZ, HEALTH_ACC_CLIPS);
+
+    mag->present = AQ_MAG_ENABLED;
+    healthSample(mag, now, IMU_MAG_LASTUPD, IMU_MAGX, IMU_MAGY, IMU_MAGZ, 0);
+    // only analog IMU builds fuse the mag (run.c), digital builds just
+    // report it in the notices and SYS_STATUS
+    if (mag->present && calibData.disturbed)
+        mag->faults |= HEALTH_DISTURBED;
+
+    healthSample(&healthData.chan[HEALTH_PRES], now, AQ_PRES_LASTUPD, AQ_PRESSURE, 0.0f, 0.0f, 0);
+
+    healthGps(&healthData.chan[HEALTH_GPS], now);
+}
+
+// time stamp of a channel's latest data, for CAN that of the node heard from least recently
+static uint32_t healthStamp(int i) {
+    uint32_t stamp, age, maxAge;
+    int j;
+
+    switch (i) {
+    case HEALTH_GYO:
+    case HEALTH_ACC:
+        return IMU_LASTUPD;
+    case HEALTH_MAG:
+        return IMU_MAG_LASTUPD;
+    case HEALTH_PRES:
+        return AQ_PRES_LASTUPD;
+    case HEALTH_GPS:
+        return gpsData.lastPosUpdate;
+    default:
+        stamp = 0;
+        maxAge = 0;
+        for (j = 0; j < CAN_SENSORS_NUM; j++) {
+            if (canSensorsData.nodes[j]) {
+                if (!canSensorsData.rcvTimes[j])
+                    return 0;
+
+                age = timerMicros() - canSensorsData.rcvTimes[j];
+                if (!stamp || age > maxAge) {
+                    stamp = canSensorsData.rcvTimes[j];
+                    maxAge = age;
+                }
+            }
+        }
+        return stamp;
+    }
+}
+
+// supervisor task, evaluate staleness and announce changes
+void healthReport(void) {
+    healthChannel_t *c;
+    const char *fault;
+    uint32_t stamp;
+    uint8_t faults;
+    int i, j;
+
+    c = &healthData.chan[HEALTH_CAN];
+    c->present = 0;
+    for (j = 0; j < CAN_SENSORS_NUM; j++)
+        if (canSensorsData.nodes[j])
+            c->present = 1;
+
+    for (i = 0; i < HEALTH_NUM; i++) {
+        c = &healthData.chan[i];
+
+        // the stamp must be read before the time
+        stamp = healthStamp(i);
+        c->stale = c->present && (!stamp || (int32_t)(timerMicros() - stamp) > (int32_t)c->staleTime);
+
+        faults = HEALTH_FAULTS(i);
+
+        if (faults == healthData.reported[i])
+            continue;
+
+        if (faults) {
+            if (faults & HEALTH_STALE)
+                fault = "stale";
+            else if (faults & HEALTH_STUCK)
+                fault = "stuck";
+            else if (faults & HEALTH_SATURATED)
+                fault = "saturated";
+            else if (faults & HEALTH_DISTURBED)
+                fault = "disturbed";
+            else if (faults & HEALTH_POOR)
+                fault = "inaccurate";
+            else if (faults & HEALTH_JUMP)
+                fault = "jumped";
+            else
+                fault = "noisy";
+
+            AQ_PRINTF("Warning: %s sensor %s\n", healthNames[i], fault);
+        }
+        else {
+            AQ_PRINTF("%s sensor recovered\n", healthNames[i]);
+        }
+
+        if (faults && !healthData.reported[i])
+            healthData.faultCount[i]++;
+
+        healthData.reported[i] = faults;
+    }
+}
+
+void healthInit(void) {
+    memset((void *)&healthData, 0, sizeof(healthData));
+
+    healthChannelInit(&healthData.chan[HEALTH_GYO], 3, HEALTH_IMU_STALE, HEALTH_GYO_NOISE);
+    healthChannelInit(&healthData.chan[HEALTH_ACC], 3, HEALTH_IMU_STALE, HEALTH_ACC_NOISE);
+    healthChannelInit(&healthData.chan[HEALTH_MAG], 3, HEALTH_MAG_STALE, HEALTH_MAG_NOISE);
+    healthChannelInit(&healthData.chan[HEALTH_PRES], 1, HEALTH_PRES_STALE, HEALTH_PRES_NOISE);
+    healthChannelInit(&healthData.chan[HEALTH_GPS], 0, HEALTH_GPS_STALE, 0.0f);
+    healthChannelInit(&healthData.chan[HEALTH_CAN], 0, HEALTH_CAN_STALE, 0.0f);
+
+    // only count clips from here on
+    healthData.chan[HEALTH_GYO].clips = HEALTH_GYO_CLIPS;
+    healthData.chan[HEALTH_ACC].clips = HEALTH_ACC_CLIPS;
+}
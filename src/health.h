@@ -0,0 +1,103 @@
+/*
+    This file is part of AutoQuad.
+
+    AutoQuad is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AutoQuad is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with AutoQuad.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright (c) 2011-2014  Bill Nesbitt
+*/
+
+#ifndef _health_h
+#define _health_h
+
+#include "aq.h"
+#include "util.h"
+
+#define HEALTH_WINDOW       20          // sensor updates per noise window
+
+#define HEALTH_IMU_STALE    50000       // us
+#define HEALTH_MAG_STALE    200000      // us
+#define HEALTH_PRES_STALE   200000      // us
+#define HEALTH_GPS_STALE    2000000     // us
+#define HEALTH_CAN_STALE    1000000     // us, telemetry runs at CAN_SENSORS_RATE
+#define HEALTH_STUCK_TIME   1000000     // us of updates without any change
+#define HEALTH_SAT_HOLD     500000      // us a clipped sample keeps the channel faulted
+
+// std over the window, summed over axes
+#define HEALTH_GYO_NOISE    8.0f        // rad/s
+#define HEALTH_ACC_NOISE    30.0f       // m/s^2
+#define HEALTH_MAG_NOISE    0.3f        // normalized
+#define HEALTH_PRES_NOISE   100.0f      // Pa
+
+#define HEALTH_GPS_HACC     10.0f       // m
+#define HEALTH_GPS_SATS     5
+#define HEALTH_GPS_SPEED    50.0f       // m/s, fastest plausible move between fixes
+#define HEALTH_GPS_JUMP_HOLD 2000000    // us a position jump keeps the channel faulted
+
+// faults are evaluated by the run task, staleness by the supervisor so that a
+// sensor which stops the run task is still caught
+#define HEALTH_FAULTS(c)    (healthData.chan[c].faults | (healthData.chan[c].stale ? HEALTH_STALE : 0))
+#define HEALTH_GOOD(c)      (!HEALTH_FAULTS(c))
+
+enum healthChannels {
+    HEALTH_GYO = 0,
+    HEALTH_ACC,
+    HEALTH_MAG,
+    HEALTH_PRES,
+    HEALTH_GPS,
+    HEALTH_CAN,
+    HEALTH_NUM
+};
+
+enum healthFaults {
+    HEALTH_STALE     = 0x01,
+    HEALTH_STUCK     = 0x02,
+    HEALTH_SATURATED = 0x04,
+    HEALTH_NOISY     = 0x08,
+    HEALTH_DISTURBED = 0x10,    // mag reading off the calibrated ellipsoid, reported only on digital IMU builds
+    HEALTH_POOR      = 0x20,    // GPS accuracy or satellite count too low
+    HEALTH_JUMP      = 0x40     // GPS position moved further than possible
+};
+
+typedef struct {
+    utilRunStat_t stat[3];
+    float hist[3][HEALTH_WINDOW];
+    float last[3];
+    float noise;                // max summed std
+    uint32_t staleTime;         // us
+    uint32_t lastUpdate;        // sensor time stamp of the last sample taken
+    uint32_t lastChange;
+    uint32_t lastSat;
+    uint32_t clips;             // driver clip count at the last sample
+    uint8_t axes;
+    uint8_t present;
+    uint8_t faults;             // healthFaults, run task
+    uint8_t stale;              // supervisor
+} healthChannel_t;
+
+typedef struct {
+    healthChannel_t chan[HEALTH_NUM];
+    uint8_t reported[HEALTH_NUM];
+    uint32_t faultCount[HEALTH_NUM];
+
+    double gpsLat, gpsLon;      // last fix that passed the checks
+    uint32_t gpsFix;            // its time stamp
+    uint32_t gpsJump;
+} healthStruct_t;
+
+extern healthStruct_t healthData;
+
+extern void healthInit(void);
+extern void healthCheck(void);
+extern void healthReport(void);
+
+#endif
@@ -49,3 +49,37 @@ void CoStkOverflowHook(OS_TID taskID) {
 
     }
 }
+
+#if CFG_TASK_SWITCH_HOOK_EN > 0
+/**
+ *******************************************************************************
+ * @brief      Hook for task switch
+ * @param[in]  curTaskID  Task being switched out.
+ * @param[in]  nextTaskID Task being switched in.
+ * @param[out] None
+ * @retval     None
+ *
+ * @par Description
+ * @details    This function is called from Schedule() right before a context
+ *             switch. Keep it short, it may run in interrupt context.
+ *******************************************************************************
+ */
+void CoTaskSwitchHook(OS_TID curTaskID, OS_TID nextTaskID) {
+    /* Add your codes here */
+}
+
+/**
+ *******************************************************************************
+ * @brief      Hook for task ready
+ * @param[in]  taskID Task which was put into the READY list.
+ * @param[out] None
+ * @retval     None
+ *
+ * @par Description
+ * @details    This function is called when a waiting task becomes ready.
+ *******************************************************************************
+ */
+void CoTaskReadyHook(OS_TID taskID) {
+    /* Add your codes here */
+}
+#endif
@@ -17,40 +17,36 @@
  */
 
 #include "imu.h"
-#include "arm_math.h"
 #include "config.h"
 #include <string.h>
+#include <math.h>
 
 imuStruct_t imuData CCM_RAM;
 
 // wait for lack of movement
 void imuQuasiStatic(int n) {
     uint32_t lastUpdate;
-    float stdX, stdY, stdZ;
+    utilRunStat_t acc[3];
     float vX[n];
     float vY[n];
     float vZ[n];
-    int i, j;
+    int i;
+
+    utilRunStatInit(&acc[0], vX, n);
+    utilRunStatInit(&acc[1], vY, n);
+    utilRunStatInit(&acc[2], vZ, n);
 
     i = 0;
-    j = 0;
     do {
         lastUpdate = IMU_LASTUPD;
         while (lastUpdate == IMU_LASTUPD);
 
-        vX[j] = IMU_ACCX;
-        vY[j] = IMU_ACCY;
-        vZ[j] = IMU_ACCZ;
-        j = (j + 1) % n;
-
-        if (i >= n) {
-            arm_std_f32(vX, n, &stdX);
-            arm_std_f32(vY, n, &stdY);
-            arm_std_f32(vZ, n, &stdZ);
-        }
+        utilRunStat(&acc[0], IMU_ACCX);
+        utilRunStat(&acc[1], IMU_ACCY);
+        utilRunStat(&acc[2], IMU_ACCZ);
 
         i++;
-    } while (i < (int)(1.0f / AQ_OUTER_TIMESTEP)*IMU_STATIC_TIMEOUT && (i <= n || (stdX + stdY + stdZ) > IMU_STATIC_STD));
+    } while (i < (int)(1.0f / AQ_OUTER_TIMESTEP)*IMU_STATIC_TIMEOUT && (i <= n || (utilRunStatStd(&acc[0]) + utilRunStatStd(&acc[1]) + utilRunStatStd(&acc[2])) > IMU_STATIC_STD));
 }
 
 void imuCalcRot(void) {
@@ -65,6 +61,8 @@ void imuCalcRot(void) {
 void imuInit(void) {
     memset((void *)&imuData, 0, sizeof(imuData));
 
+    utilSeqLatchInit(&imuData.sampleLatch, &imuData.sample[0], &imuData.sample[1], sizeof(imuSample_t));
+
     imuData.dRateFlag = CoCreateFlag(1, 0);
     imuData.sensorFlag = CoCreateFlag(1, 0);
 
@@ -80,6 +78,29 @@ void imuInit(void) {
 #endif // HAS_DIGITAL_IMU
 }
 
+static void imuPublishSample(void) {
+    imuSample_t s;
+
+    s.rate[0] = IMU_RATEX;
+    s.rate[1] = IMU_RATEY;
+    s.rate[2] = IMU_RATEZ;
+    s.acc[0] = IMU_ACCX;
+    s.acc[1] = IMU_ACCY;
+    s.acc[2] = IMU_ACCZ;
+    s.mag[0] = IMU_MAGX;
+    s.mag[1] = IMU_MAGY;
+    s.mag[2] = IMU_MAGZ;
+    s.temp = IMU_TEMP;
+    s.pressure = AQ_PRESSURE;
+    s.lastUpdate = IMU_LASTUPD;
+
+    utilSeqPublish(&imuData.sampleLatch, &s);
+}
+
+void imuGetSample(imuSample_t *s) {
+    utilSeqRead(&imuData.sampleLatch, s);
+}
+
 void imuAdcDRateReady(void) {
 #ifndef USE_DIGITAL_IMU
     imuData.halfUpdates++;
@@ -89,6 +110,7 @@ void imuAdcDRateReady(void) {
 
 void imuAdcSensorReady(void) {
 #ifndef USE_DIGITAL_IMU
+    imuPublishSample();
     imuData.fullUpdates++;
     CoSetFlag(imuData.sensorFlag);
 #endif
@@ -103,6 +125,7 @@ void imuDImuDRateReady(void) {
 
 void imuDImuSensorReady(void) {
 #ifdef USE_DIGITAL_IMU
+    imuPublishSample();
     imuData.fullUpdates++;
     CoSetFlag(imuData.sensorFlag);
 #endif // USE_DIGITAL_IMU
@@ -22,15 +22,16 @@
 #include "aq.h"
 #include "adc.h"
 #include "d_imu.h"
+#include "util.h"
 
 #define IMU_ROOM_TEMP  20.0f
 #define IMU_STATIC_STD  0.05f
 #define IMU_STATIC_TIMEOUT 5 // seconds
 
 // these define where to get certain data
-#define AQ_YAW   navUkfData.yaw
-#define AQ_PITCH  navUkfData.pitch
-#define AQ_ROLL   navUkfData.roll
+#define AQ_YAW   UKF_ATT.yaw
+#define AQ_PITCH  UKF_ATT.pitch
+#define AQ_ROLL   UKF_ATT.roll
 #define AQ_PRES_ADJ  UKF_PRES_ALT
 
 #ifdef USE_DIGITAL_IMU
@@ -51,6 +52,8 @@
 #define IMU_RAW_ACCX    max21100Data.rawAcc[0]
 #define IMU_RAW_ACCY    max21100Data.rawAcc[1]
 #define IMU_RAW_ACCZ    max21100Data.rawAcc[2]
+#define IMU_GYO_CLIPS   max21100Data.gyoClips
+#define IMU_ACC_CLIPS   max21100Data.accClips
 #endif
 #ifdef DIMU_HAVE_MPU6000
 #define IMU_DRATEX  mpu6000Data.dRateGyo[0]
@@ -68,6 +71,8 @@
 #define IMU_RAW_ACCX    mpu6000Data.rawAcc[0]
 #define IMU_RAW_ACCY    mpu6000Data.rawAcc[1]
 #define IMU_RAW_ACCZ    mpu6000Data.rawAcc[2]
+#define IMU_GYO_CLIPS   mpu6000Data.gyoClips
+#define IMU_ACC_CLIPS   mpu6000Data.accClips
 #endif
 #ifdef DIMU_HAVE_HMC5983
 #define IMU_MAGX          hmc5983Data.mag[0]
@@ -77,6 +82,7 @@
 #define IMU_RAW_MAGY      hmc5983Data.rawMag[1]
 #define IMU_RAW_MAGZ      hmc5983Data.rawMag[2]
 #define AQ_MAG_ENABLED    hmc5983Data.enabled
+#define IMU_MAG_LASTUPD   hmc5983Data.lastUpdate
 #endif  /* DIMU_HAVE_HMC5983 */
 #ifdef DIMU_HAVE_MAG3110
 #define IMU_MAGX       mag3110Data.mag[0]
@@ -86,6 +92,7 @@
 #define IMU_RAW_MAGY   mag3110Data.rawMag[1]
 #define IMU_RAW_MAGZ   mag3110Data.rawMag[2]
 #define AQ_MAG_ENABLED mag3110Data.enabled
+#define IMU_MAG_LASTUPD mag3110Data.lastUpdate
 #endif  /* DIMU_HAVE_MAG3110 */
 
 #define IMU_TEMP          dImuData.temp
@@ -93,6 +100,7 @@
 #define AQ_OUTER_TIMESTEP DIMU_OUTER_DT
 #define AQ_INNER_TIMESTEP DIMU_INNER_DT
 #define AQ_PRESSURE       ms5611Data.pres
+#define AQ_PRES_LASTUPD   ms5611Data.lastUpdate
 
 #endif // USE_DIGITAL_IMU
 
@@ -124,10 +132,24 @@
 #define AQ_OUTER_TIMESTEP adcData.dt
 #define AQ_INNER_TIMESTEP (adcData.dt * 0.5f)
 #define AQ_PRESSURE  adcData.pressure
+#define AQ_PRES_LASTUPD  adcData.lastUpdate
+#define IMU_MAG_LASTUPD  adcData.lastUpdate
 #define AQ_MAG_ENABLED          1
 #endif
 
+// raw sensor sample latched when a full update completes
 typedef struct {
+    float rate[3];
+    float acc[3];
+    float mag[3];
+    float temp;
+    float pressure;
+    uint32_t lastUpdate;
+} imuSample_t;
+
+typedef struct {
+    imuSample_t sample[2];
+    utilSeqLatch_t sampleLatch;
     OS_FlagID dRateFlag;
     OS_FlagID sensorFlag;
     float sinRot, cosRot;
@@ -143,5 +165,6 @@ extern void imuAdcDRateReady(void);
 extern void imuAdcSensorReady(void);
 extern void imuDImuDRateReady(void);
 extern void imuDImuSensorReady(void);
+extern void imuGetSample(imuSample_t *s);
 
 #endif
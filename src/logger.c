@@ -36,6 +36,7 @@
 #include "gimbal.h"
 #include "canSensors.h"
 #include "alt_ukf.h"
+#include "vibe.h"
 #include <CoOS.h>
 #include <stdio.h>
 #include <string.h>
@@ -107,6 +108,8 @@ loggerFields_t loggerFields[] = {
         {LOG_UKF_PRES_ALT, AQ_TYPE_FLT},
         {LOG_UKF_ALT, AQ_TYPE_FLT},
         {LOG_UKF_ALT_VEL, AQ_TYPE_FLT},
+        {LOG_ALT_KF_POS, AQ_TYPE_FLT},
+        {LOG_ALT_KF_VEL, AQ_TYPE_FLT},
         {LOG_UKF_VELN, AQ_TYPE_FLT},
         {LOG_UKF_VELE, AQ_TYPE_FLT},
         {LOG_UKF_VELD, AQ_TYPE_FLT},
@@ -157,6 +160,14 @@ loggerFields_t loggerFields[] = {
         {LOG_CURRENT_EXT, AQ_TYPE_FLT},
 #endif
         {LOG_VIN_PDB, AQ_TYPE_FLT},
+#ifdef HAS_VIBE
+        {LOG_VIBE_GYO_FREQ, AQ_TYPE_FLT},
+        {LOG_VIBE_GYO_AMP, AQ_TYPE_FLT},
+        {LOG_VIBE_GYO_RMS, AQ_TYPE_FLT},
+        {LOG_VIBE_ACC_FREQ, AQ_TYPE_FLT},
+        {LOG_VIBE_ACC_AMP, AQ_TYPE_FLT},
+        {LOG_VIBE_ACC_RMS, AQ_TYPE_FLT},
+#endif
 };
 
 int loggerCopy8(void *to, void *from) {
@@ -452,6 +463,32 @@ void loggerSetup(void) {
         case LOG_UKF_ALT_VEL:
             loggerData.fp[i].fieldPointer = (void *)&ALT_VEL;
             break;
+        case LOG_ALT_KF_POS:
+            loggerData.fp[i].fieldPointer = (void *)&ALT_KF_POS;
+            break;
+        case LOG_ALT_KF_VEL:
+            loggerData.fp[i].fieldPointer = (void *)&ALT_KF_VEL;
+            break;
+#ifdef HAS_VIBE
+        case LOG_VIBE_GYO_FREQ:
+            loggerData.fp[i].fieldPointer = (void *)&vibeData.gyoFreq;
+            break;
+        case LOG_VIBE_GYO_AMP:
+            loggerData.fp[i].fieldPointer = (void *)&vibeData.gyoAmp;
+            break;
+        case LOG_VIBE_GYO_RMS:
+            loggerData.fp[i].fieldPointer = (void *)&vibeData.gyoRms;
+            break;
+        case LOG_VIBE_ACC_FREQ:
+            loggerData.fp[i].fieldPointer = (void *)&vibeData.accFreq;
+            break;
+        case LOG_VIBE_ACC_AMP:
+            loggerData.fp[i].fieldPointer = (void *)&vibeData.accAmp;
+            break;
+        case LOG_VIBE_ACC_RMS:
+            loggerData.fp[i].fieldPointer = (void *)&vibeData.accRms;
+            break;
+#endif
         case LOG_UKF_VELN:
             loggerData.fp[i].fieldPointer = (void *)&UKF_VELN;
             break;
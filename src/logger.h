@@ -133,6 +133,14 @@ enum {
     LOG_CURRENT_EXT,
     LOG_VIN_PDB,
     LOG_UKF_ALT_VEL,
+    LOG_ALT_KF_POS,
+    LOG_ALT_KF_VEL,
+    LOG_VIBE_GYO_FREQ,
+    LOG_VIBE_GYO_AMP,
+    LOG_VIBE_GYO_RMS,
+    LOG_VIBE_ACC_FREQ,
+    LOG_VIBE_ACC_AMP,
+    LOG_VIBE_ACC_RMS,
     LOG_NUM_IDS
 };
 
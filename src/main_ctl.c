@@ -78,6 +78,18 @@ void CoStkOverflowHook(OS_TID taskID) {
         ;
 }
 
+void CoTaskSwitchHook(OS_TID curTaskID, OS_TID nextTaskID) {
+#ifdef UTIL_TASK_STATS
+    utilTaskSwitch(curTaskID, nextTaskID);
+#endif
+}
+
+void CoTaskReadyHook(OS_TID taskID) {
+#ifdef UTIL_TASK_STATS
+    utilTaskReady(taskID);
+#endif
+}
+
 #ifdef DEBUG_ENABLED
 #include <stdio.h>
 void HardFault_RegDump(unsigned int* stack) {
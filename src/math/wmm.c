@@ -20,16 +20,23 @@
  */
 
 /**
- * @file wmm2015.c
+ * @file wmm.c
  * @brief WMM2015 Geomagnetic field model.
  *
  * Based on the WMM2015 model (http://www.ngdc.noaa.gov/geomag/WMM/DoDWMM.shtml)
+ *
+ * Single precision version.  The associated Legendre recursion constants only
+ * depend on the degree and order, so they are computed once by wmmInit() and
+ * the coefficients are only time adjusted when the date changes.
  */
 
 #include "wmm.h"
-#include "math.h"
+#include <math.h>
+#include <string.h>
+
+wmmStruct_t wmmData;
 
-const double gh1[MAXCOEFF] = {
+const float wmmGh1[MAXCOEFF] = {
         //WMM 2015 data
         0.0, -29438.5, -1501.1, 4796.2,
         -2445.3, 3012.5, -2845.6, 1676.6, -642.0,
@@ -45,7 +52,7 @@ const double gh1[MAXCOEFF] = {
         -2.0, -0.3, -1.0, 0.4, 0.5, 1.3, 1.8, -0.9, -2.2, 0.9, 0.3, 0.1, 0.7, 0.5, -0.1, -0.4, 0.3, -0.4, 0.2, 0.2, -0.9, -0.9, -0.2, 0.0, 0.7
 };
 
-const double gh2[MAXCOEFF] =  {
+const float wmmGh2[MAXCOEFF] =  {
         //WMM 2015 data
         0.0, 10.7, 17.9, -26.8,
         -8.6, 0.0, -3.3, -27.1, 2.4, -13.3,
@@ -61,189 +68,167 @@ const double gh2[MAXCOEFF] =  {
         0.1, 0.0, 0.0, 0.0, 0.0, 0.1, -0.1, -0.1, 0.0, 0.0, 0.0, 0.1, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0
 };
 
-int16_t extrapsh(double date, double dte1, int16_t nmax1, int16_t nmax2, double *gh) {
-    int16_t   nmax;
-    int16_t   k, l;
-    int16_t   ii;
-    double factor;
-
-    factor = date - dte1;
-    if (nmax1 == nmax2) {
-        k =  nmax1 * (nmax1 + 2);
-        nmax = nmax1;
-    } else {
-        if (nmax1 > nmax2) {
-            k = nmax2 * (nmax2 + 2);
-            l = nmax1 * (nmax1 + 2);
-
-            for (ii = k + 1; ii <= l; ++ii) {
-                gh[ii] = gh1[ii];
-            }
+void wmmInit(void) {
+    float fn, fm, aa, bb, cc;
+    int k, n, m;
 
-            nmax = nmax1;
-        } else {
-            k = nmax1 * (nmax1 + 2);
-            l = nmax2 * (nmax2 + 2);
+    memset((void *)&wmmData, 0, sizeof(wmmData));
 
-            for (ii = k + 1; ii <= l; ++ii) {
-                gh[ii] = factor * gh2[ii];
-            }
+    n = 0;
+    m = 1;
+    for (k = 1; k <= WMM_NPQ; k++) {
+        if (n < m) {
+            m = 0;
+            n++;
+        }
+        fn = n;
+        fm = m;
 
-            nmax = nmax2;
+        wmmData.n[k] = n;
+        wmmData.m[k] = m;
+
+        if (m == n) {
+            aa = sqrtf(1.0f - 0.5f / fm);
+            wmmData.c1[k] = (1.0f + 1.0f / fm) * aa;
+            wmmData.c3[k] = aa;
+            wmmData.c4[k] = 1.0f / fm;
         }
-    }
+        else if (n > 1) {
+            aa = sqrtf(fn * fn - fm * fm);
+            bb = sqrtf((fn - 1.0f) * (fn - 1.0f) - fm * fm) / aa;
+            cc = (2.0f * fn - 1.0f) / aa;
+            wmmData.c1[k] = (fn + 1.0f) * cc / fn;
+            wmmData.c2[k] = (fn + 1.0f) * bb / (fn - 1.0f);
+            wmmData.c3[k] = cc;
+            wmmData.c4[k] = 1.0f / fn;
+            wmmData.c5[k] = bb;
+        }
+        wmmData.c6[k] = fm / (fn + 1.0f);
 
-    for (ii = 1; ii <= k; ++ii) {
-        gh[ii] = gh1[ii] + factor * gh2[ii];
+        m++;
     }
 
-    return (nmax);
+    wmmSetDate(WMM_EPOCH);
 }
 
-int16_t mag_calc(int16_t igdgc, double flat, double flon, double elev, int16_t nmax,
-                 double *gh, double *geo_mag_x, double *geo_mag_y, double *geo_mag_z,
-                 int16_t iext, double ext1, double ext2, double ext3) {
-    double earths_radius = 6371.2;
-    double dtr = 0.01745329;
-    double slat;
-    double clat;
-    double ratio;
-    double aa, bb, cc, dd;
-    double sd;
-    double cd;
-    double r;
-    double a2;
-    double b2;
-    double rr = 0;
-    double fm, fn = 0;
-    double sl[14];
-    double cl[14];
-    double p[119];
-    double q[119];
-    int ii, j, k, l, m, n;
-    int npq;
-    int ios;
-    double argument;
-    double power;
-    a2 = 40680631.59;            /* WGS84 */
-    b2 = 40408299.98;            /* WGS84 */
-    ios = 0;
-    r = elev;
-    argument = flat * dtr;
-    slat = sin(argument);
-    if ((90.0L - flat) < 0.001L) {
-        aa = 89.999L;            /* in meters from North pole  */
-    } else {
-        if ((90.0L + flat) < 0.001L) {
-            aa = -89.999L;       /*  in meters from South pole  */
-        } else {
-            aa = flat;
-        }
-    }
-    argument = aa * dtr;
-    clat = cos(argument);
-    argument = flon * dtr;
-    sl[1] = sin(argument);
-    cl[1] = cos(argument);
-
-    *geo_mag_x = 0;
-    *geo_mag_y = 0;
-    *geo_mag_z = 0;
-
-    sd = 0.0;
-    cd = 1.0;
-    l = 1;
-    n = 0;
-    m = 1;
-    npq = (nmax * (nmax + 3)) / 2;
-
-    if (igdgc == 1) {
-        aa = a2 * clat * clat;
-        bb = b2 * slat * slat;
-        cc = aa + bb;
-        argument = cc;
-        dd = sqrt(argument);
-        argument = elev * (elev + 2.0L * dd) + (a2 * aa + b2 * bb) / cc;
-        r = sqrt(argument);
-        cd = (elev + dd) / r;
-        sd = (a2 - b2) / dd * slat * clat / r;
-        aa = slat;
-        slat = slat * cd - clat * sd;
-        clat = clat * cd + aa * sd;
-    }
+// time adjust the model coefficients, year as a decimal (e.g. 2016.5)
+void wmmSetDate(float year) {
+    float dt;
+    int i;
 
-    ratio = earths_radius / r;
-    argument = 3.0;
-    aa = sqrt(argument);
-    p[1] = 2.0L * slat;
-    p[2] = 2.0L * clat;
-    p[3] = 4.5L * slat * slat - 1.5L;
-    p[4] = 3.0L * aa * clat * slat;
+    if (year < WMM_YR_MIN)
+        year = WMM_YR_MIN;
+    else if (year > WMM_YR_MAX)
+        year = WMM_YR_MAX;
+
+    dt = year - WMM_EPOCH;
+
+    for (i = 1; i <= WMM_NMAX * (WMM_NMAX + 2); i++)
+        wmmData.gh[i] = wmmGh1[i] + dt * wmmGh2[i];
+
+    wmmData.year = year;
+}
+
+// field at a geodetic position (degrees, degrees, km above the ellipsoid),
+// returns north, east, down components in nT
+void wmmCalc(float lat, float lon, float alt, float *b) {
+    float p[WMM_NPQ+1];
+    float q[WMM_NPQ+1];
+    float sl[WMM_NMAX+1];
+    float cl[WMM_NMAX+1];
+    float *gh = wmmData.gh;
+    float slat, clat, sd, cd;
+    float r, ratio, rr;
+    float aa, bb, cc, dd;
+    float x, y, z;
+    int i, j, k, l, m, n;
+
+    slat = sinf(lat * DEG_TO_RAD);
+    if (lat > 89.999f)
+        lat = 89.999f;
+    else if (lat < -89.999f)
+        lat = -89.999f;
+    clat = cosf(lat * DEG_TO_RAD);
+
+    sl[1] = sinf(lon * DEG_TO_RAD);
+    cl[1] = cosf(lon * DEG_TO_RAD);
+
+    // geodetic to geocentric
+    aa = WMM_A2 * clat * clat;
+    bb = WMM_B2 * slat * slat;
+    cc = aa + bb;
+    dd = sqrtf(cc);
+    r = sqrtf(alt * (alt + 2.0f * dd) + (WMM_A2 * aa + WMM_B2 * bb) / cc);
+    cd = (alt + dd) / r;
+    sd = (WMM_A2 - WMM_B2) / dd * slat * clat / r;
+    aa = slat;
+    slat = slat * cd - clat * sd;
+    clat = clat * cd + aa * sd;
+
+    ratio = WMM_RE / r;
+
+    aa = sqrtf(3.0f);
+    p[1] = 2.0f * slat;
+    p[2] = 2.0f * clat;
+    p[3] = 4.5f * slat * slat - 1.5f;
+    p[4] = 3.0f * aa * clat * slat;
     q[1] = -clat;
     q[2] = slat;
-    q[3] = -3.0L * clat * slat;
+    q[3] = -3.0f * clat * slat;
     q[4] = aa * (slat * slat - clat * clat);
 
-    for (k = 1; k <= npq; ++k) {
-        if (n < m) {
-            m = 0;
-            n = n + 1;
-            argument = ratio;
-            power =  n + 2;
-            rr = pow(argument, power);
-            fn = n;
-        }
-        fm = m;
+    x = 0.0f;
+    y = 0.0f;
+    z = 0.0f;
+
+    rr = ratio * ratio;
+    l = 1;
+    for (k = 1; k <= WMM_NPQ; k++) {
+        n = wmmData.n[k];
+        m = wmmData.m[k];
+
+        // (r0/r)^(n+2)
+        if (m == 0)
+            rr *= ratio;
+
         if (k >= 5) {
             if (m == n) {
-                argument = (1.0L - 0.5L / fm);
-                aa = sqrt(argument);
                 j = k - n - 1;
-                p[k] = (1.0L + 1.0L / fm) * aa * clat * p[j];
-                q[k] = aa * (clat * q[j] + slat / fm * p[j]);
+                p[k] = wmmData.c1[k] * clat * p[j];
+                q[k] = wmmData.c3[k] * (clat * q[j] + slat * wmmData.c4[k] * p[j]);
                 sl[m] = sl[m - 1] * cl[1] + cl[m - 1] * sl[1];
                 cl[m] = cl[m - 1] * cl[1] - sl[m - 1] * sl[1];
-            } else {
-                argument = fn * fn - fm * fm;
-                aa = sqrt(argument);
-                argument = ((fn - 1.0L) * (fn - 1.0L)) - (fm * fm);
-                bb = sqrt(argument) / aa;
-                cc = (2.0L * fn - 1.0L) / aa;
-                ii = k - n;
+            }
+            else {
+                i = k - n;
                 j = k - 2 * n + 1;
-                p[k] = (fn + 1.0L) * (cc * slat / fn * p[ii] - bb / (fn - 1.0L) * p[j]);
-                q[k] = cc * (slat * q[ii] - clat / fn * p[ii]) - bb * q[j];
+                p[k] = wmmData.c1[k] * slat * p[i] - wmmData.c2[k] * p[j];
+                q[k] = wmmData.c3[k] * (slat * q[i] - clat * wmmData.c4[k] * p[i]) - wmmData.c5[k] * q[j];
             }
         }
 
         aa = rr * gh[l];
 
         if (m == 0) {
-            *geo_mag_x = *geo_mag_x + aa * q[k];
-            *geo_mag_z = *geo_mag_z - aa * p[k];
-            l = l + 1;
-        } else {
+            x += aa * q[k];
+            z -= aa * p[k];
+            l++;
+        }
+        else {
             bb = rr * gh[l + 1];
             cc = aa * cl[m] + bb * sl[m];
-            *geo_mag_x = *geo_mag_x + cc * q[k];
-            *geo_mag_z = *geo_mag_z - cc * p[k];
-            if (clat > 0) {
-                *geo_mag_y = *geo_mag_y + (aa * sl[m] - bb * cl[m]) * fm * p[k] / ((fn + 1.0L) * clat);
-            } else {
-                *geo_mag_y = *geo_mag_y + (aa * sl[m] - bb * cl[m]) * q[k] * slat;
-            }
-            l = l + 2;
+            x += cc * q[k];
+            z -= cc * p[k];
+            if (clat > 0.0f)
+                y += (aa * sl[m] - bb * cl[m]) * wmmData.c6[k] * p[k] / clat;
+            else
+                y += (aa * sl[m] - bb * cl[m]) * q[k] * slat;
+            l += 2;
         }
-        m = m + 1;
     }
-    if (iext != 0) {
-        aa = ext2 * cl[1] + ext3 * sl[1];
-        *geo_mag_x = *geo_mag_x - ext1 * clat + aa * slat;
-        *geo_mag_y = *geo_mag_y + ext2 * sl[1] - ext3 * cl[1];
-        *geo_mag_z = *geo_mag_z + ext1 * slat + aa * clat;
-    }
-    aa = *geo_mag_x;
-    *geo_mag_x = *geo_mag_x * cd + *geo_mag_z * sd;
-    *geo_mag_z = *geo_mag_z * cd - aa * sd;
-    return ios;
+
+    // rotate back to the geodetic frame
+    b[0] = x * cd + z * sd;
+    b[1] = y;
+    b[2] = z * cd - x * sd;
 }
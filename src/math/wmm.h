@@ -20,7 +20,7 @@
  */
 
 /**
- * @file wmm2015.h
+ * @file wmm.h
  * @brief WMM2015 Geomagnetic field model.
  *
  * Based on the WMM2015 model (http://www.ngdc.noaa.gov/geomag/models.shtml)
@@ -31,47 +31,40 @@
 
 #include "aq.h"
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+#define WMM_EPOCH   2015.0f     // model epoch
+#define WMM_YR_MIN  2015.0f
+#define WMM_YR_MAX  2020.0f     // secular variation is not extrapolated past this
 
-#define WMM2015_FRAC 2
-#define N_MAX_OF_GH  12
+#define WMM_NMAX    12
+#define WMM_NPQ     ((WMM_NMAX * (WMM_NMAX + 3)) / 2)
 
-// Geo mag current observation epoch begin
-#define GEO_EPOCH 2015.
-#define YR_MIN    2015.
-#define YR_MAX    2020.
-#define NMAX_1 12
-#define NMAX_2 12
-
-#define IEXT 0
-#define EXT_COEFF1 (double)0
-#define EXT_COEFF2 (double)0
-#define EXT_COEFF3 (double)0
-
-/// Begin of the GPS epoch
-#define GPS_EPOCH_BEGIN (double)1980.016393442623
-#define GPS_EPOCH_YEAR  1980
-#define GPS_EPOCH_MONTH 1
-#define GPS_EPOCH_DAY   6
-
-#define WEEKS_IN_YEAR 52.14285
-#define SECS_IN_YEAR 31536000
+#define WMM_RE      6371.2f         // geomagnetic reference radius (km)
+#define WMM_A2      40680631.59f    // WGS84 semi-major axis squared (km^2)
+#define WMM_B2      40408299.98f    // WGS84 semi-minor axis squared (km^2)
 
 #define MAXDEG 13
 #define MAXCOEFF (MAXDEG*(MAXDEG+2)+1)
 
-extern const double gh1[];
-extern const double gh2[];
+typedef struct {
+    float gh[MAXCOEFF];         // coefficients at wmmData.year
+    float c1[WMM_NPQ+1];        // Legendre recursion constants per (n, m) term
+    float c2[WMM_NPQ+1];
+    float c3[WMM_NPQ+1];
+    float c4[WMM_NPQ+1];
+    float c5[WMM_NPQ+1];
+    float c6[WMM_NPQ+1];
+    uint8_t n[WMM_NPQ+1];
+    uint8_t m[WMM_NPQ+1];
+    float year;
+} wmmStruct_t;
+
+extern wmmStruct_t wmmData;
 
-int16_t extrapsh(double date, double dte1, int16_t nmax1, int16_t nmax2, double *gh);
-int16_t mag_calc(int16_t igdgc, double flat, double flon, double elev, int16_t nmax,
-                 double *gh, double *geo_mag_x, double *geo_mag_y, double *geo_mag_z,
-                 int16_t iext, double ext1, double ext2, double ext3);
+extern const float wmmGh1[];
+extern const float wmmGh2[];
 
-#ifdef __cplusplus
-} /* extern "C" */
-#endif
+extern void wmmInit(void);
+extern void wmmSetDate(float year);
+extern void wmmCalc(float lat, float lon, float alt, float *b);
 
 #endif /* WMM2015_H */
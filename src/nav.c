@@ -116,8 +116,8 @@ void navRecallHome(void) {
 void navSetHfReference(uint8_t refType) {
     if (refType == 0) {
         // use current heading as reference
-        navData.hfReferenceCos = navUkfData.yawCos;
-        navData.hfReferenceSin = navUkfData.yawSin;
+        navData.hfReferenceCos = UKF_ATT.yawCos;
+        navData.hfReferenceSin = UKF_ATT.yawSin;
         navData.hfUseStoredReference = 1;
     } else if (navData.navCapable) {
         // use current bearing from home position
@@ -571,8 +571,8 @@ void navNavigate(void) {
         }
         else {
             // rotate to earth frame
-            navData.holdSpeedN = x * navUkfData.yawCos - y * navUkfData.yawSin;
-            navData.holdSpeedE = y * navUkfData.yawCos + x * navUkfData.yawSin;
+            navData.holdSpeedN = x * UKF_ATT.yawCos - y * UKF_ATT.yawSin;
+            navData.holdSpeedE = y * UKF_ATT.yawCos + x * UKF_ATT.yawSin;
         }
     }
     // orbit POI
@@ -586,8 +586,8 @@ void navNavigate(void) {
         velY = -curLeg->maxHorizSpeed;
 
         // rotate to earth frame
-        navData.holdSpeedN = velX * navUkfData.yawCos - velY * navUkfData.yawSin;
-        navData.holdSpeedE = velY * navUkfData.yawCos + velX * navUkfData.yawSin;
+        navData.holdSpeedN = velX * UKF_ATT.yawCos - velY * UKF_ATT.yawSin;
+        navData.holdSpeedE = velY * UKF_ATT.yawCos + velX * UKF_ATT.yawSin;
     }
     else {
         // distance => velocity
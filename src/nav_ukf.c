@@ -26,6 +26,10 @@
 #include "gps.h"
 #include "supervisor.h"
 #include "filer.h"
+#include "comm.h"
+#include "rtc.h"
+#include "wmm.h"
+#include <stdlib.h>
 #ifndef __CC_ARM
 #include <intrinsics.h>
 #endif
@@ -59,9 +63,9 @@ static void navUkfResetPosition(float deltaN, float deltaE, float deltaD) {
     int i;
 
     for (i = 0; i < UKF_HIST; i++) {
-        navUkfData.posN[i] += deltaN;
-        navUkfData.posE[i] += deltaE;
-        navUkfData.posD[i] += deltaD;
+        navUkfData.hist[i].pos[0] += deltaN;
+        navUkfData.hist[i].pos[1] += deltaE;
+        navUkfData.hist[i].pos[2] += deltaD;
     }
 
     UKF_POSN += deltaN;
@@ -380,17 +384,170 @@ void navUkfOfPosUpdate(float *u, float *x, float *noise, float *y) {
     y[2] = x[UKF_STATE_POSD] + noise[2]; // alt
 }
 
+// build this cycle's attitude snapshot in the unused buffer, then publish it
 void navUkfFinish(void) {
+    navUkfAttitude_t attWork, *att = &attWork;
+    navUkfOutput_t out;
+    float h;
+
     navUkfNormalizeQuat(&UKF_Q1, &UKF_Q1);
-    navUkfQuatExtractEuler(&UKF_Q1, &navUkfData.yaw, &navUkfData.pitch, &navUkfData.roll);
-    navUkfData.yaw = compassNormalize(navUkfData.yaw * RAD_TO_DEG);
-    navUkfData.pitch *= RAD_TO_DEG;
-    navUkfData.roll *= RAD_TO_DEG;
+
+    att->q[0] = UKF_Q1;
+    att->q[1] = UKF_Q2;
+    att->q[2] = UKF_Q3;
+    att->q[3] = UKF_Q4;
+    navUkfQuatToMatrix(att->dcm, att->q, 0);
+
+    navUkfQuatExtractEuler(att->q, &att->yaw, &att->pitch, &att->roll);
+    att->yaw = compassNormalize(att->yaw * RAD_TO_DEG);
+    att->pitch *= RAD_TO_DEG;
+    att->roll *= RAD_TO_DEG;
 
     //    x' = x cos f - y sin f
     //    y' = y cos f + x sin f
-    navUkfData.yawCos = cosf(navUkfData.yaw * DEG_TO_RAD);
-    navUkfData.yawSin = sinf(navUkfData.yaw * DEG_TO_RAD);
+    // yaw = atan2(m10, m00), so take its sin/cos straight from the matrix
+    h = __sqrtf(att->dcm[0*3 + 0]*att->dcm[0*3 + 0] + att->dcm[1*3 + 0]*att->dcm[1*3 + 0]);
+    if (h > 1e-6f) {
+        att->yawCos = att->dcm[0*3 + 0] / h;
+        att->yawSin = att->dcm[1*3 + 0] / h;
+    }
+    else {
+        att->yawCos = cosf(att->yaw * DEG_TO_RAD);
+        att->yawSin = sinf(att->yaw * DEG_TO_RAD);
+    }
+
+    att->micros = IMU_LASTUPD;
+    utilSeqPublish(&navUkfData.attLatch, att);
+
+    memcpy(out.x, navUkfData.x, sizeof(out.x));
+    out.micros = IMU_LASTUPD;
+    utilSeqPublish(&navUkfData.outLatch, &out);
+}
+
+void navUkfGetAttitude(navUkfAttitude_t *att) {
+    utilSeqRead(&navUkfData.attLatch, att);
+}
+
+void navUkfGetOutput(navUkfOutput_t *out) {
+    utilSeqRead(&navUkfData.outLatch, out);
+}
+
+static void navUkfSnapshot(navUkfHist_t *h) {
+    h->vel[0] = UKF_VELN;
+    h->vel[1] = UKF_VELE;
+    h->vel[2] = UKF_VELD;
+    h->pos[0] = UKF_POSN;
+    h->pos[1] = UKF_POSE;
+    h->pos[2] = UKF_POSD;
+    h->q[0] = UKF_Q1;
+    h->q[1] = UKF_Q2;
+    h->q[2] = UKF_Q3;
+    h->q[3] = UKF_Q4;
+    h->micros = IMU_LASTUPD;
+}
+
+// state at an earlier epoch, interpolated between the two snapshots around it.
+// Epochs after the newest snapshot get the current state, epochs before the
+// oldest one get the oldest.
+static void navUkfGetHist(uint32_t micros, navUkfHist_t *h) {
+    navUkfHist_t *a, *b = 0;
+    float f;
+    int i, j, k;
+
+    navUkfSnapshot(h);
+
+    j = navUkfData.navHistIndex;
+    for (i = 0; i < UKF_HIST; i++) {
+        j = (j + UKF_HIST - 1) % UKF_HIST;
+        a = &navUkfData.hist[j];
+
+        if (a->micros == 0)
+            break;
+
+        if ((int32_t)(micros - a->micros) >= 0) {
+            // newer than the newest snapshot, h already holds the current state
+            if (b != 0) {
+                f = (float)(micros - a->micros) / (float)(b->micros - a->micros);
+
+                for (k = 0; k < 3; k++) {
+                    h->vel[k] = a->vel[k] + (b->vel[k] - a->vel[k]) * f;
+                    h->pos[k] = a->pos[k] + (b->pos[k] - a->pos[k]) * f;
+                }
+                for (k = 0; k < 4; k++)
+                    h->q[k] = a->q[k] + (b->q[k] - a->q[k]) * f;
+                navUkfNormalizeQuat(h->q, h->q);
+
+                h->micros = micros;
+            }
+            return;
+        }
+
+        b = a;
+    }
+
+    if (b)
+        *h = *b;
+}
+
+// Fuse a measurement of vel/pos taken at an earlier epoch.  The nav states
+// are moved back to where they were at that time, updated, and then carried
+// forward again by the motion accumulated since.  delta[6] returns that motion.
+static void navUkfDelayedUpdate(uint32_t micros, float *y, int n, float *noise, SRCDKFMeasurementUpdate_t *update, float *delta) {
+    navUkfHist_t h;
+    int i;
+
+    navUkfGetHist(micros, &h);
+
+    for (i = 0; i < 3; i++) {
+        delta[i] = navUkfData.x[UKF_STATE_VELN+i] - h.vel[i];
+        delta[3+i] = navUkfData.x[UKF_STATE_POSN+i] - h.pos[i];
+
+        navUkfData.x[UKF_STATE_VELN+i] = h.vel[i];
+        navUkfData.x[UKF_STATE_POSN+i] = h.pos[i];
+    }
+
+    srcdkfMeasurementUpdate(navUkfData.kf, 0, y, n, n, noise, update);
+
+    for (i = 0; i < 3; i++) {
+        navUkfData.x[UKF_STATE_VELN+i] += delta[i];
+        navUkfData.x[UKF_STATE_POSN+i] += delta[3+i];
+    }
+}
+
+// Take over a new mag reference vector from the WMM task.  Digital IMU
+// builds do not fuse the mag in flight, their heading was aligned to v0m
+// once at boot, so turn it by the change in declination instead.
+static void navUkfWmmUpdate(void) {
+    float v0m[3];
+#ifdef USE_DIGITAL_IMU
+    float q[4];
+    float d, c, s;
+#endif
+
+    navUkfData.wmmSeq = navUkfData.wmmLatch.seq;
+    utilSeqRead(&navUkfData.wmmLatch, v0m);
+
+#ifdef USE_DIGITAL_IMU
+    // half the yaw change, applied as a rotation about the NED down axis
+    d = 0.5f * (atan2f(v0m[1], v0m[0]) - atan2f(navUkfData.v0m[1], navUkfData.v0m[0]));
+    c = cosf(d);
+    s = sinf(d);
+
+    q[0] = UKF_Q1;
+    q[1] = UKF_Q2;
+    q[2] = UKF_Q3;
+    q[3] = UKF_Q4;
+
+    UKF_Q1 = c*q[0] - s*q[3];
+    UKF_Q2 = c*q[1] - s*q[2];
+    UKF_Q3 = c*q[2] + s*q[1];
+    UKF_Q4 = c*q[3] + s*q[0];
+    navUkfNormalizeQuat(&UKF_Q1, &UKF_Q1);
+#endif
+
+    navUkfData.v0m[0] = v0m[0];
+    navUkfData.v0m[1] = v0m[1];
+    navUkfData.v0m[2] = v0m[2];
 }
 
 void navUkfInertialUpdate(void) {
@@ -404,16 +561,19 @@ void navUkfInertialUpdate(void) {
     u[4] = IMU_RATEY;
     u[5] = IMU_RATEZ;
 
+    // pick up a new mag reference vector from the WMM task
+#ifdef USE_DIGITAL_IMU
+    // a heading step while armed would yaw the craft, wait for disarm
+    if (navUkfData.wmmLatch.seq != navUkfData.wmmSeq && !(supervisorData.state & STATE_ARMED))
+#else
+    if (navUkfData.wmmLatch.seq != navUkfData.wmmSeq)
+#endif
+        navUkfWmmUpdate();
+
     srcdkfTimeUpdate(navUkfData.kf, u, AQ_OUTER_TIMESTEP);
 
     // store history
-    navUkfData.posN[navUkfData.navHistIndex] = UKF_POSN;
-    navUkfData.posE[navUkfData.navHistIndex] = UKF_POSE;
-    navUkfData.posD[navUkfData.navHistIndex] = UKF_POSD;
-
-    navUkfData.velN[navUkfData.navHistIndex] = UKF_VELN;
-    navUkfData.velE[navUkfData.navHistIndex] = UKF_VELE;
-    navUkfData.velD[navUkfData.navHistIndex] = UKF_VELD;
+    navUkfSnapshot(&navUkfData.hist[navUkfData.navHistIndex]);
 
     navUkfData.navHistIndex = (navUkfData.navHistIndex + 1) % UKF_HIST;
 }
@@ -523,8 +683,7 @@ void navUkfZeroPos(void) {
 void navUkfGpsPosUpdate(uint32_t gpsMicros, double lat, double lon, float alt, float hAcc, float vAcc) {
     float y[3];
     float noise[3];
-    float posDelta[3];
-    int histIndex;
+    float delta[6];
 
     if (navUkfData.holdLat == (double)0.0) {
         navUkfData.holdLat = lat;
@@ -537,34 +696,12 @@ void navUkfGpsPosUpdate(uint32_t gpsMicros, double lat, double lon, float alt, f
         navUkfCalcGlobalDistance(lat, lon, &y[0], &y[1]);
         y[2] = alt;
 
-        // determine how far back this GPS position update came from
-        histIndex = (timerMicros() - (gpsMicros + UKF_POS_DELAY)) / (int)(1e6f * AQ_OUTER_TIMESTEP);
-        histIndex = navUkfData.navHistIndex - histIndex;
-        if (histIndex < 0)
-            histIndex += UKF_HIST;
-        if (histIndex < 0 || histIndex >= UKF_HIST)
-            histIndex = 0;
-
-        // calculate delta from current position
-        posDelta[0] = UKF_POSN - navUkfData.posN[histIndex];
-        posDelta[1] = UKF_POSE - navUkfData.posE[histIndex];
-        posDelta[2] = UKF_POSD - navUkfData.posD[histIndex];
-
-        // set current position state to historic data
-        UKF_POSN = navUkfData.posN[histIndex];
-        UKF_POSE = navUkfData.posE[histIndex];
-        UKF_POSD = navUkfData.posD[histIndex];
-
         noise[0] = UKF_GPS_POS_N + hAcc * __sqrtf(gpsData.tDOP*gpsData.tDOP + gpsData.nDOP*gpsData.nDOP) * UKF_GPS_POS_M_N;
         noise[1] = UKF_GPS_POS_N + hAcc * __sqrtf(gpsData.tDOP*gpsData.tDOP + gpsData.eDOP*gpsData.eDOP) * UKF_GPS_POS_M_N;
         noise[2] = UKF_GPS_ALT_N + vAcc * __sqrtf(gpsData.tDOP*gpsData.tDOP + gpsData.vDOP*gpsData.vDOP) * UKF_GPS_ALT_M_N;
 
-        srcdkfMeasurementUpdate(navUkfData.kf, 0, y, 3, 3, noise, navUkfPosUpdate);
-
-        // add the historic position delta back to the current state
-        UKF_POSN += posDelta[0];
-        UKF_POSE += posDelta[1];
-        UKF_POSD += posDelta[2];
+        // fuse against the state at the time the GPS position was valid
+        navUkfDelayedUpdate(gpsMicros + UKF_POS_DELAY, y, 3, noise, navUkfPosUpdate, delta);
 
 #ifdef UKF_LOG_FNAME
         {
@@ -578,9 +715,9 @@ void navUkfGpsPosUpdate(uint32_t gpsMicros, double lat, double lon, float alt, f
             log[i++] = noise[0];
             log[i++] = noise[1];
             log[i++] = noise[2];
-            log[i++] = posDelta[0];
-            log[i++] = posDelta[1];
-            log[i++] = posDelta[2];
+            log[i++] = delta[3];
+            log[i++] = delta[4];
+            log[i++] = delta[5];
 
             navUkfData.logPointer = (navUkfData.logPointer + UKF_LOG_SIZE) % UKF_LOG_BUF_SIZE;
             filerSetHead(navUkfData.logHandle, navUkfData.logPointer);
@@ -613,41 +750,18 @@ void navUkfZeroVel(void) {
 void navUkfGpsVelUpdate(uint32_t gpsMicros, float velN, float velE, float velD, float sAcc) {
     float y[3];
     float noise[3];
-    float velDelta[3];
-    int histIndex;
+    float velDelta[6];
 
     y[0] = velN;
     y[1] = velE;
     y[2] = velD;
 
-    // determine how far back this GPS velocity update came from
-    histIndex = (timerMicros() - (gpsMicros + UKF_VEL_DELAY)) / (int)(1e6f * AQ_OUTER_TIMESTEP);
-    histIndex = navUkfData.navHistIndex - histIndex;
-    if (histIndex < 0)
-        histIndex += UKF_HIST;
-    if (histIndex < 0 || histIndex >= UKF_HIST)
-        histIndex = 0;
-
-    // calculate delta from current position
-    velDelta[0] = UKF_VELN - navUkfData.velN[histIndex];
-    velDelta[1] = UKF_VELE - navUkfData.velE[histIndex];
-    velDelta[2] = UKF_VELD - navUkfData.velD[histIndex];
-
-    // set current position state to historic data
-    UKF_VELN = navUkfData.velN[histIndex];
-    UKF_VELE = navUkfData.velE[histIndex];
-    UKF_VELD = navUkfData.velD[histIndex];
-
     noise[0] = UKF_GPS_VEL_N + sAcc * __sqrtf(gpsData.tDOP*gpsData.tDOP + gpsData.nDOP*gpsData.nDOP) * UKF_GPS_VEL_M_N;
     noise[1] = UKF_GPS_VEL_N + sAcc * __sqrtf(gpsData.tDOP*gpsData.tDOP + gpsData.eDOP*gpsData.eDOP) * UKF_GPS_VEL_M_N;
     noise[2] = UKF_GPS_VD_N  + sAcc * __sqrtf(gpsData.tDOP*gpsData.tDOP + gpsData.vDOP*gpsData.vDOP) * UKF_GPS_VD_M_N;
 
-    srcdkfMeasurementUpdate(navUkfData.kf, 0, y, 3, 3, noise, navUkfVelUpdate);
-
-    // add the historic position delta back to the current state
-    UKF_VELN += velDelta[0];
-    UKF_VELE += velDelta[1];
-    UKF_VELD += velDelta[2];
+    // fuse against the state at the time the GPS velocity was valid
+    navUkfDelayedUpdate(gpsMicros + UKF_VEL_DELAY, y, 3, noise, navUkfVelUpdate, velDelta);
 
 #ifdef UKF_LOG_FNAME
     {
@@ -685,6 +799,9 @@ void navUkfFlowUpdate(void) {
     float flowAlt = 0.0f;
     float y[3];
     float noise[3];
+    float delta[6];
+    float yawCos, yawSin, m00, m10, h;
+    navUkfHist_t hist;
 
     // set default noise levels
     noise[0] = 0.001f;
@@ -721,13 +838,27 @@ void navUkfFlowUpdate(void) {
         flowX -= (AQ_PITCH - oldPitch) * DEG_TO_RAD * UKF_FOCAL_PX;
         flowY += (AQ_ROLL  - oldRoll)  * DEG_TO_RAD * UKF_FOCAL_PX;
 
+        // heading and height when the flow was measured
+        navUkfGetHist(navUkfData.flowMicros, &hist);
+        m00 = hist.q[0]*hist.q[0] + hist.q[1]*hist.q[1] - hist.q[2]*hist.q[2] - hist.q[3]*hist.q[3];
+        m10 = 2.0f * (hist.q[1]*hist.q[2] + hist.q[3]*hist.q[0]);
+        h = __sqrtf(m00*m00 + m10*m10);
+        if (h > 1e-6f) {
+            yawCos = m00 / h;
+            yawSin = m10 / h;
+        }
+        else {
+            yawCos = UKF_ATT.yawCos;
+            yawSin = UKF_ATT.yawSin;
+        }
+
         // next, rotate flow to world frame
-        xT = flowX * navUkfData.yawCos - flowY * navUkfData.yawSin;
-        yT = flowY * navUkfData.yawCos + flowX * navUkfData.yawSin;
+        xT = flowX * yawCos - flowY * yawSin;
+        yT = flowY * yawCos + flowX * yawSin;
 
         // convert to distance covered based on focal length and height above ground
-        flowX = xT * (1.0f / UKF_FOCAL_PX) * UKF_POSD;
-        flowY = yT * (1.0f / UKF_FOCAL_PX) * UKF_POSD;
+        flowX = xT * (1.0f / UKF_FOCAL_PX) * hist.pos[2];
+        flowY = yT * (1.0f / UKF_FOCAL_PX) * hist.pos[2];
 
         // integrate for absolute position
         navUkfData.flowPosN += flowX;
@@ -747,7 +878,7 @@ void navUkfFlowUpdate(void) {
         navUkfCalcLocalDistance(navUkfData.flowPosN, navUkfData.flowPosE, &y[0], &y[1]);
         y[2] = navUkfData.flowAlt;
 
-        srcdkfMeasurementUpdate(navUkfData.kf, 0, y, 3, 3, noise, navUkfOfPosUpdate);
+        navUkfDelayedUpdate(navUkfData.flowMicros, y, 3, noise, navUkfOfPosUpdate, delta);
 #ifdef UKF_LOG_FNAME
         {
             float *log = (float *)&ukfLog[navUkfData.logPointer];
@@ -805,6 +936,7 @@ void navUkfOpticalFlow(int16_t x, int16_t y, uint8_t quality, float ground) {
         navUkfData.flowSumY += (y * -0.1f);
         navUkfData.flowSumQuality += quality;
         navUkfData.flowCount++;
+        navUkfData.flowMicros = timerMicros();
     }
 
     navUkfData.flowLock = 0;
@@ -920,11 +1052,15 @@ void navUkfInit(void) {
 
     memset((void *)&navUkfData, 0, sizeof(navUkfData));
 
+    utilSeqLatchInit(&navUkfData.attLatch, &navUkfData.att[0], &navUkfData.att[1], sizeof(navUkfAttitude_t));
+    utilSeqLatchInit(&navUkfData.outLatch, &navUkfData.out[0], &navUkfData.out[1], sizeof(navUkfOutput_t));
+    utilSeqLatchInit(&navUkfData.wmmLatch, &navUkfData.wmmMag[0], &navUkfData.wmmMag[1], sizeof(navUkfData.wmmMag[0]));
+
     navUkfData.v0a[0] = 0.0f;
     navUkfData.v0a[1] = 0.0f;
     navUkfData.v0a[2] = -1.0f;
 
-    // calculate mag vector based on inclination
+    // calculate mag vector based on inclination, until the WMM task has a GPS position
     mag[0] = cosf(p[IMU_MAG_INCL] * DEG_TO_RAD);
     mag[1] = 0.0f;
     mag[2] = -sinf(p[IMU_MAG_INCL] * DEG_TO_RAD);
@@ -982,21 +1118,69 @@ void navUkfInit(void) {
 #endif
 }
 
-#ifdef WMM_STACK_SIZE
-
 OS_STK *wmmStack;
 
-void wmmTask(void* unused) {
-    for (;;) {
+// Works out the local field from the World Magnetic Model once a GPS fix is
+// available and again whenever the craft has moved far enough for it to
+// matter.  Replaces the IMU_MAG_INCL/DECL params as the UKF's mag reference.
+// Digital IMU builds only use that reference for the boot alignment, so
+// there the result corrects the heading while disarmed, see
+// navUkfWmmUpdate(), and IMU_MAG_DECL still sets the heading at boot.
+static void navUkfWmmTaskCode(void *unused) {
+    float lat, lon, alt;
+    float lastLat = 0.0f, lastLon = 0.0f;
+    float b[3], bMag;
+    long decl, incl;
+    uint32_t posUpdate;
+    uint8_t valid = 0;
+
+    wmmInit();
+
+    while (1) {
+        yield(WMM_CHECK_PERIOD);
+
+        if (gpsData.hAcc > NAV_MIN_GPS_ACC)
+            continue;
+
+        // the GPS task may update the position while we copy it
+        do {
+            posUpdate = gpsData.lastPosUpdate;
+            lat = gpsData.lat;
+            lon = gpsData.lon;
+            alt = gpsData.height;
+        } while (posUpdate != gpsData.lastPosUpdate);
+
+        if (valid && fabsf(lat - lastLat) < WMM_RECALC_DIST && fabsf(lon - lastLon) < WMM_RECALC_DIST)
+            continue;
+
+        // RTC is set from GPS time, the model clamps the year if it is not
+        wmmSetDate(1970.0f + (float)rtcGetUNIXEpoch() * (1.0f / (365.25f * 24.0f * 60.0f * 60.0f)));
+        wmmCalc(lat, lon, alt * 0.001f, b);
+
+        bMag = __sqrtf(b[0]*b[0] + b[1]*b[1] + b[2]*b[2]);
+        if (bMag > 0.0f) {
+            b[0] /= bMag;
+            b[1] /= bMag;
+            b[2] /= bMag;
+
+            utilSeqPublish(&navUkfData.wmmLatch, b);
+
+            // tenths of a degree, keeps float formatting out of this small stack
+            decl = LROUNDF(atan2f(b[1], b[0]) * RAD_TO_DEG * 10.0f);
+            incl = LROUNDF(-asinf(b[2]) * RAD_TO_DEG * 10.0f);
+            AQ_PRINTF("WMM: decl %s%ld.%ld incl %s%ld.%ld\n", (decl < 0) ? "-" : "", labs(decl) / 10, labs(decl) % 10,
+                    (incl < 0) ? "-" : "", labs(incl) / 10, labs(incl) % 10);
+        }
+
+        lastLat = lat;
+        lastLon = lon;
+        valid = 1;
     }
-    CoExitTask();
 }
 
-void startWMMDeamon(void) {
+void navUkfWmmInit(void) {
     wmmStack = aqStackInit(WMM_STACK_SIZE, "WMM");
 
-    CoCreateTask(wmmTask, (void *)0, WMM_TASK_PRIORITY, &wmmStack[WMM_STACK_SIZE-1], WMM_STACK_SIZE);
+    CoCreateTask(navUkfWmmTaskCode, (void *)0, WMM_PRIORITY, &wmmStack[WMM_STACK_SIZE-1], WMM_STACK_SIZE);
 }
 
-#endif /* WMM_STACK_SIZE */
-
@@ -21,6 +21,7 @@
 
 #include "aq.h"
 #include "srcdkf.h"
+#include "util.h"
 
 #define UKF_LOG_SIZE  (17*sizeof(float))
 #define UKF_LOG_BUF_SIZE (UKF_LOG_SIZE*40)
@@ -82,34 +83,69 @@
 #define UKF_Q4   navUkfData.x[UKF_STATE_Q4]
 #define UKF_PRES_ALT  navUkfData.x[UKF_STATE_PRES_ALT]
 
+// latest published attitude snapshot, safe for the run task and anything that
+// preempts it, lower priority tasks should take a copy with navUkfGetAttitude()
+#define UKF_ATT   navUkfData.att[navUkfData.attLatch.seq & 1]
+
 #ifdef USE_PRES_ALT
 #define UKF_ALTITUDE UKF_PRES_ALT
+#define UKF_STATE_ALTITUDE UKF_STATE_PRES_ALT
 #else
 #define UKF_ALTITUDE UKF_POSD
+#define UKF_STATE_ALTITUDE UKF_STATE_POSD
 #endif
 
-#define UKF_HIST  40
+#define UKF_HIST  40        // state history length in run cycles, must cover the slowest sensor latency
 #define UKF_P0   101325.0f       // standard static pressure at sea level
 
+#define WMM_STACK_SIZE      384     // must be evenly divisible by 8
+#define WMM_PRIORITY        63
+#define WMM_CHECK_PERIOD    1000    // ms between checks for a new GPS position
+#define WMM_RECALC_DIST     0.1f    // lat/lon change (deg) before the field is recalculated
+
 #define UKF_FLOW_ROT  -90.0f        // optical flow mounting rotation in degrees
 #define UKF_FOCAL_LENGTH 16.0f        // 16mm
 #define UKF_FOCAL_PX  (UKF_FOCAL_LENGTH / (4.0f * 6.0f) * 1000.0f)   // pixel size: 6um, binning 4 enabled
 
+// attitude snapshot built once per run cycle by navUkfFinish()
+typedef struct {
+    float q[4];         // attitude quaternion (normalized)
+    float dcm[9];       // rotation matrix body to world frame (row major)
+    float yaw, pitch, roll;  // degrees
+    float yawCos, yawSin;
+    uint32_t micros;    // IMU timestamp of the estimate
+} navUkfAttitude_t;
+
+// compact nav state snapshot kept every run cycle so that late measurements
+// can be fused against the epoch they were taken at
+typedef struct {
+    float vel[3];
+    float pos[3];
+    float q[4];
+    uint32_t micros;    // IMU timestamp of the snapshot, 0 if not filled yet
+} navUkfHist_t;
+
+// complete state snapshot for readers outside of the run task
+typedef struct {
+    float x[SIM_S];
+    uint32_t micros;
+} navUkfOutput_t;
+
 typedef struct {
     srcdkf_t *kf;
     float v0a[3];
     float v0m[3];
+    float wmmMag[2][3];         // latched, published by the WMM task
+    utilSeqLatch_t wmmLatch;
+    uint32_t wmmSeq;            // last wmmLatch sequence copied into v0m
     double holdLat, holdLon;
     double r1, r2;
-    float posN[UKF_HIST];
-    float posE[UKF_HIST];
-    float posD[UKF_HIST];
-    float velN[UKF_HIST];
-    float velE[UKF_HIST];
-    float velD[UKF_HIST];
+    navUkfHist_t hist[UKF_HIST];
     int navHistIndex;
-    float yaw, pitch, roll;
-    float yawCos, yawSin;
+    navUkfAttitude_t att[2];    // latched, readers use UKF_ATT or navUkfGetAttitude()
+    navUkfOutput_t out[2];      // latched, readers use navUkfGetOutput()
+    utilSeqLatch_t attLatch;
+    utilSeqLatch_t outLatch;
     float *x;   // states
     float flowSumX, flowSumY;
     int32_t flowSumQuality;
@@ -120,18 +156,17 @@ typedef struct {
     float flowAlt;
     float flowRotCos, flowRotSin;
     uint32_t flowCount, flowAltCount;
+    uint32_t flowMicros;        // arrival time of the latest flow sample
     int logPointer;
     volatile uint8_t flowLock;
     uint8_t flowInit;
     uint8_t logHandle;
-#ifdef WMM_STACK_SIZE
-    //OS_FlagID wmmTimeFlag;
-#endif
 } navUkfStruct_t;
 
 extern navUkfStruct_t navUkfData;
 
 extern void navUkfInit(void);
+extern void navUkfWmmInit(void);
 extern void navUkfInertialUpdate(void);
 extern void simDoPresUpdate(float pres);
 extern void simDoAccUpdate(float accX, float accY, float accZ);
@@ -145,12 +180,15 @@ extern void navUkfSetHereAsPositionTarget(void);
 extern void navUkfQuatExtractEuler(float *q, float *yaw, float *pitch, float *roll);
 extern void navUkfZeroRate(float zRate, int axis);
 extern void navUkfFinish(void);
+extern void navUkfGetAttitude(navUkfAttitude_t *att);
+extern void navUkfGetOutput(navUkfOutput_t *out);
 extern void navUkfRotateVectorByRevQuat(float *vr, float *v, float *q);
 extern void navUkfResetBias(void);
 extern void navUkfResetVels(void);
 extern void navUkfZeroPos(void);
 extern void navUkfZeroVel(void);
 extern void navUkfRotateVectorByQuat(float *vr, float *v, float *q);
+extern void navUkfRotateVecByMatrix(float *vr, float *v, float *m);
 extern float navUkfPresToAlt(float pressure);
 
 #endif
@@ -33,6 +33,7 @@
 #include "aq_mavlink.h"
 #include "calib.h"
 #include "alt_ukf.h"
+#include "health.h"
 #include <CoOS.h>
 #ifndef __CC_ARM
 #include <intrinsics.h>
@@ -57,49 +58,29 @@ void runTaskCode(void *unused) {
 
         navUkfInertialUpdate();
 
-        // record history for acc & mag & pressure readings for smoothing purposes
-        // acc
-        runData.sumAcc[0] -= runData.accHist[0][runData.sensorHistIndex];
-        runData.sumAcc[1] -= runData.accHist[1][runData.sensorHistIndex];
-        runData.sumAcc[2] -= runData.accHist[2][runData.sensorHistIndex];
-
-        runData.accHist[0][runData.sensorHistIndex] = IMU_ACCX;
-        runData.accHist[1][runData.sensorHistIndex] = IMU_ACCY;
-        runData.accHist[2][runData.sensorHistIndex] = IMU_ACCZ;
-
-        runData.sumAcc[0] += runData.accHist[0][runData.sensorHistIndex];
-        runData.sumAcc[1] += runData.accHist[1][runData.sensorHistIndex];
-        runData.sumAcc[2] += runData.accHist[2][runData.sensorHistIndex];
-
-        // mag
-        runData.sumMag[0] -= runData.magHist[0][runData.sensorHistIndex];
-        runData.sumMag[1] -= runData.magHist[1][runData.sensorHistIndex];
-        runData.sumMag[2] -= runData.magHist[2][runData.sensorHistIndex];
+        // screen sensors before their data is used for measurement updates
+        healthCheck();
 
-        runData.magHist[0][runData.sensorHistIndex] = IMU_MAGX;
-        runData.magHist[1][runData.sensorHistIndex] = IMU_MAGY;
-        runData.magHist[2][runData.sensorHistIndex] = IMU_MAGZ;
-
-        runData.sumMag[0] += runData.magHist[0][runData.sensorHistIndex];
-        runData.sumMag[1] += runData.magHist[1][runData.sensorHistIndex];
-        runData.sumMag[2] += runData.magHist[2][runData.sensorHistIndex];
+        // record history for acc & mag & pressure readings for smoothing purposes
+        utilRunStat(&runData.acc[0], IMU_ACCX);
+        utilRunStat(&runData.acc[1], IMU_ACCY);
+        utilRunStat(&runData.acc[2], IMU_ACCZ);
 
-        // pressure
-        runData.sumPres -= runData.presHist[runData.sensorHistIndex];
-        runData.presHist[runData.sensorHistIndex] = AQ_PRESSURE;
-        runData.sumPres += runData.presHist[runData.sensorHistIndex];
+        utilRunStat(&runData.mag[0], IMU_MAGX);
+        utilRunStat(&runData.mag[1], IMU_MAGY);
+        utilRunStat(&runData.mag[2], IMU_MAGZ);
 
-        runData.sensorHistIndex = (runData.sensorHistIndex + 1) % RUN_SENSOR_HIST;
+        utilRunStat(&runData.pres, AQ_PRESSURE);
 
-        if (!((loops+1) % 20)) {
-            simDoAccUpdate(runData.sumAcc[0]*(1.0f / (float)RUN_SENSOR_HIST), runData.sumAcc[1]*(1.0f / (float)RUN_SENSOR_HIST), runData.sumAcc[2]*(1.0f / (float)RUN_SENSOR_HIST));
+        if (!((loops+1) % 20) && HEALTH_GOOD(HEALTH_ACC)) {
+            simDoAccUpdate(runData.acc[0].mean, runData.acc[1].mean, runData.acc[2].mean);
         }
-        else if (!((loops+7) % 20)) {
-            simDoPresUpdate(runData.sumPres*(1.0f / (float)RUN_SENSOR_HIST));
+        else if (!((loops+7) % 20) && HEALTH_GOOD(HEALTH_PRES)) {
+            simDoPresUpdate(runData.pres.mean);
         }
 #ifndef USE_DIGITAL_IMU
-        else if (!((loops+13) % 20) && AQ_MAG_ENABLED) {
-            simDoMagUpdate(runData.sumMag[0]*(1.0f / (float)RUN_SENSOR_HIST), runData.sumMag[1]*(1.0f / (float)RUN_SENSOR_HIST), runData.sumMag[2]*(1.0f / (float)RUN_SENSOR_HIST));
+        else if (!((loops+13) % 20) && AQ_MAG_ENABLED && HEALTH_GOOD(HEALTH_MAG)) {
+            simDoMagUpdate(runData.mag[0].mean, runData.mag[1].mean, runData.mag[2].mean);
         }
 #endif
         // optical flow update
@@ -107,7 +88,7 @@ void runTaskCode(void *unused) {
             navUkfFlowUpdate();
         }
         // only accept GPS updates if there is no optical flow
-        else if (CoAcceptSingleFlag(gpsData.gpsPosFlag) == E_OK && navUkfData.flowQuality == 0.0f && gpsData.hAcc < NAV_MIN_GPS_ACC && gpsData.tDOP != 0.0f) {
+        else if (CoAcceptSingleFlag(gpsData.gpsPosFlag) == E_OK && HEALTH_GOOD(HEALTH_GPS) && navUkfData.flowQuality == 0.0f && gpsData.hAcc < NAV_MIN_GPS_ACC && gpsData.tDOP != 0.0f) {
             navUkfGpsPosUpdate(gpsData.lastPosUpdate, gpsData.lat, gpsData.lon, gpsData.height, gpsData.hAcc + runData.accMask, gpsData.vAcc + runData.accMask);
             CoClearFlag(gpsData.gpsPosFlag);
             // refine static sea level pressure based on better GPS altitude fixes
@@ -116,7 +97,7 @@ void runTaskCode(void *unused) {
                 runData.bestHacc = gpsData.hAcc;
             }
         }
-        else if (CoAcceptSingleFlag(gpsData.gpsVelFlag) == E_OK && navUkfData.flowQuality == 0.0f && gpsData.sAcc < NAV_MIN_GPS_ACC/2 && gpsData.tDOP != 0.0f) {
+        else if (CoAcceptSingleFlag(gpsData.gpsVelFlag) == E_OK && HEALTH_GOOD(HEALTH_GPS) && navUkfData.flowQuality == 0.0f && gpsData.sAcc < NAV_MIN_GPS_ACC/2 && gpsData.tDOP != 0.0f) {
             navUkfGpsVelUpdate(gpsData.lastVelUpdate, gpsData.velN, gpsData.velE, gpsData.velD, gpsData.sAcc + runData.accMask);
             CoClearFlag(gpsData.gpsVelFlag);
         }
@@ -129,14 +110,8 @@ void runTaskCode(void *unused) {
             navUkfZeroVel();
         }
         // observe that the rates are exactly 0 if not flying or moving
-        else if (!(supervisorData.state & STATE_FLYING)) {
-            float stdX, stdY, stdZ;
-
-            arm_std_f32(runData.accHist[0], RUN_SENSOR_HIST, &stdX);
-            arm_std_f32(runData.accHist[1], RUN_SENSOR_HIST, &stdY);
-            arm_std_f32(runData.accHist[2], RUN_SENSOR_HIST, &stdZ);
-
-            if ((stdX + stdY + stdZ) < (IMU_STATIC_STD*2)) {
+        else if (!(supervisorData.state & STATE_FLYING) && HEALTH_GOOD(HEALTH_GYO) && HEALTH_GOOD(HEALTH_ACC)) {
+            if ((utilRunStatStd(&runData.acc[0]) + utilRunStatStd(&runData.acc[1]) + utilRunStatStd(&runData.acc[2])) < (IMU_STATIC_STD*2)) {
                 if (!((axis + 0) % 3))
                     navUkfZeroRate(IMU_RATEX, 0);
                 else if (!((axis + 1) % 3))
@@ -203,25 +178,16 @@ void runInit(void) {
     pres = AQ_PRESSURE;
 
     // initialize sensor history
-    for (i = 0; i < RUN_SENSOR_HIST; i++) {
-        runData.accHist[0][i] = acc[0];
-        runData.accHist[1][i] = acc[1];
-        runData.accHist[2][i] = acc[2];
-        runData.magHist[0][i] = mag[0];
-        runData.magHist[1][i] = mag[1];
-        runData.magHist[2][i] = mag[2];
-        runData.presHist[i] = pres;
-
-        runData.sumAcc[0] += acc[0];
-        runData.sumAcc[1] += acc[1];
-        runData.sumAcc[2] += acc[2];
-        runData.sumMag[0] += mag[0];
-        runData.sumMag[1] += mag[1];
-        runData.sumMag[2] += mag[2];
-        runData.sumPres += pres;
+    for (i = 0; i < 3; i++) {
+        utilRunStatInit(&runData.acc[i], runData.accHist[i], RUN_SENSOR_HIST);
+        utilRunStatInit(&runData.mag[i], runData.magHist[i], RUN_SENSOR_HIST);
+        utilRunStatFill(&runData.acc[i], acc[i]);
+        utilRunStatFill(&runData.mag[i], mag[i]);
     }
+    utilRunStatInit(&runData.pres, runData.presHist, RUN_SENSOR_HIST);
+    utilRunStatFill(&runData.pres, pres);
 
-    runData.sensorHistIndex = 0;
+    calibInit();
 
     runData.bestHacc = 1000.0f;
     runData.accMask = 1000.0f;
@@ -19,6 +19,7 @@
 #ifndef _run_h
 #define _run_h
 
+#include "util.h"
 #include <CoOS.h>
 
 #define RUN_TASK_SIZE  250
@@ -38,10 +39,9 @@ typedef struct {
     float accHist[3][RUN_SENSOR_HIST];
     float magHist[3][RUN_SENSOR_HIST];
     float presHist[RUN_SENSOR_HIST];
-    float sumAcc[3];
-    float sumMag[3];
-    float sumPres;
-    int sensorHistIndex;
+    utilRunStat_t acc[3];
+    utilRunStat_t mag[3];
+    utilRunStat_t pres;
     float *altPos;
     float *altVel;
 } runStruct_t;
@@ -35,6 +35,7 @@
 #include "motors.h"
 #include "calib.h"
 #include "run.h"
+#include "health.h"
 #include "canSensors.h"
 #ifdef USE_SIGNALING
 #include "signaling.h"
@@ -139,6 +140,8 @@ void supervisorArm(void) {
         AQ_NOTICE("Error: Can't arm, home command active.\n");
     else if (rcIsSwitchActive(NAV_CTRL_HF_SET) || rcIsSwitchActive(NAV_CTRL_HF_LOCK))
         AQ_NOTICE("Error: Can't arm, heading-free mode active.\n");
+    else if (!HEALTH_GOOD(HEALTH_GYO) || !HEALTH_GOOD(HEALTH_ACC))
+        AQ_NOTICE("Error: Can't arm, IMU sensor fault.\n");
     else if (motorsArm()) {
         supervisorData.state = STATE_ARMED | (supervisorData.state & (STATE_LOW_BATTERY1 | STATE_LOW_BATTERY2));
         AQ_NOTICE("Armed\n");
@@ -153,7 +156,6 @@ void supervisorArm(void) {
 
 void supervisorDisarm(void) {
     motorsDisarm();
-    calibDeinit();
     supervisorLEDsOff();
     supervisorData.state = STATE_DISARMED | (supervisorData.state & (STATE_LOW_BATTERY1 | STATE_LOW_BATTERY2));
     AQ_NOTICE("Disarmed\n");
@@ -443,12 +445,15 @@ void supervisorTaskCode(void *unused) {
         // calculate idle time
         supervisorData.idlePercent = (counter - lastAqCounter) * minCycles * 100.0f / ((1e6f / SUPERVISOR_RATE) * rccClocks.SYSCLK_Frequency / 1e6f);
         lastAqCounter = counter;
+#ifdef UTIL_TASK_STATS
+        utilTaskStatsUpdate();
+#endif
 
         // smooth vIn readings
         supervisorData.vInLPF += (analogData.vIn - supervisorData.vInLPF) * (0.1f / SUPERVISOR_RATE);
 
-        // smooth current flow readings, if any
-        if (supervisorData.currentSenseValPtr)
+        // smooth current flow readings, if any, holding the last one while the CAN PDB is silent
+        if (supervisorData.currentSenseValPtr && (supervisorData.currentSenseValPtr != &canSensorsData.values[CAN_SENSORS_PDB_BATA] || HEALTH_GOOD(HEALTH_CAN)))
             supervisorData.aOutLPF += (*supervisorData.currentSenseValPtr - supervisorData.aOutLPF) * (0.1f / SUPERVISOR_RATE);
 
         //calculate remaining battery % based on configured low batt stg 2 level -- ASSumes 4.2v/cell maximum
@@ -469,6 +474,13 @@ void supervisorTaskCode(void *unused) {
         }
         // end battery level checks
 
+        if (supervisorData.state != STATE_INITIALIZING) {
+            healthReport();
+#ifdef HAS_DIGITAL_IMU
+            dIMUCheckNotches();
+#endif
+        }
+
         supervisorSetSystemStatus();
 
         if (supervisorData.state & STATE_FLYING) {
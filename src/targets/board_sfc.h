@@ -21,10 +21,6 @@
 #define HAS_USB
 #define HAS_AQ_TELEMETRY
 
-// test wmm
-#define WMM_STACK_SIZE    512
-#define WMM_TASK_PRIORITY 200
-
 #define STM32F4_DEFECTS  // workaround for exti issues
 
 #define SDIO_DMA                DMA2
@@ -78,6 +78,9 @@ static uint8_t *telemtrySendInt(uint8_t *ptr, uint32_t i) {
 void telemetryDo(void) {
     static unsigned long lastAqUpdate = 0;
     commTxBuf_t *txBuf;
+    navUkfAttitude_t att;
+    navUkfOutput_t ukf;
+    imuSample_t imu;
     uint8_t *ptr;
 
     telemetryData.loops++;
@@ -99,29 +102,33 @@ void telemetryDo(void) {
 
                 telemetryData.ckA = telemetryData.ckB = 0;
 
-                ptr = telemtrySendFloat(ptr, AQ_ROLL);
-                ptr = telemtrySendFloat(ptr, AQ_PITCH);
-                ptr = telemtrySendFloat(ptr, AQ_YAW);
+                navUkfGetAttitude(&att);
+                navUkfGetOutput(&ukf);
+                imuGetSample(&imu);
+
+                ptr = telemtrySendFloat(ptr, att.roll);
+                ptr = telemtrySendFloat(ptr, att.pitch);
+                ptr = telemtrySendFloat(ptr, att.yaw);
                 ptr = telemtrySendInt(ptr, RADIO_THROT);
                 ptr = telemtrySendInt(ptr, RADIO_RUDD);
                 ptr = telemtrySendInt(ptr, RADIO_PITCH);
                 ptr = telemtrySendInt(ptr, RADIO_ROLL);
                 ptr = telemtrySendInt(ptr, rcGetControlValue(NAV_CTRL_PH));
                 ptr = telemtrySendInt(ptr, radioData.channels[8]);
-                ptr = telemtrySendFloat(ptr, IMU_RATEX);
-                ptr = telemtrySendFloat(ptr, IMU_RATEY);
-                ptr = telemtrySendFloat(ptr, IMU_RATEZ);
-                ptr = telemtrySendFloat(ptr, IMU_ACCX);
-                ptr = telemtrySendFloat(ptr, IMU_ACCY);
-                ptr = telemtrySendFloat(ptr, IMU_ACCZ);
+                ptr = telemtrySendFloat(ptr, imu.rate[0]);
+                ptr = telemtrySendFloat(ptr, imu.rate[1]);
+                ptr = telemtrySendFloat(ptr, imu.rate[2]);
+                ptr = telemtrySendFloat(ptr, imu.acc[0]);
+                ptr = telemtrySendFloat(ptr, imu.acc[1]);
+                ptr = telemtrySendFloat(ptr, imu.acc[2]);
                 ptr = telemtrySendFloat(ptr, navData.holdHeading);
-                ptr = telemtrySendFloat(ptr, AQ_PRESSURE);
-                ptr = telemtrySendFloat(ptr, IMU_TEMP);
+                ptr = telemtrySendFloat(ptr, imu.pressure);
+                ptr = telemtrySendFloat(ptr, imu.temp);
                 ptr = telemtrySendFloat(ptr, ALTITUDE);
                 ptr = telemtrySendFloat(ptr, analogData.vIn);
-                ptr = telemtrySendInt(ptr, IMU_LASTUPD - gpsData.lastPosUpdate);  // us
-                ptr = telemtrySendFloat(ptr, UKF_POSN);
-                ptr = telemtrySendFloat(ptr, UKF_POSE);
+                ptr = telemtrySendInt(ptr, imu.lastUpdate - gpsData.lastPosUpdate);  // us
+                ptr = telemtrySendFloat(ptr, ukf.x[UKF_STATE_POSN]);
+                ptr = telemtrySendFloat(ptr, ukf.x[UKF_STATE_POSE]);
                 ptr = telemtrySendFloat(ptr, ALT_POS);
                 ptr = telemtrySendFloat(ptr, gpsData.lat);
                 ptr = telemtrySendFloat(ptr, gpsData.lon);
@@ -134,22 +141,22 @@ void telemetryDo(void) {
                 ptr = telemtrySendFloat(ptr, navData.holdAlt);
                 ptr = telemtrySendFloat(ptr, navData.holdTiltN);
                 ptr = telemtrySendFloat(ptr, navData.holdTiltE);
-                ptr = telemtrySendFloat(ptr, UKF_VELN);
-                ptr = telemtrySendFloat(ptr, UKF_VELE);
+                ptr = telemtrySendFloat(ptr, ukf.x[UKF_STATE_VELN]);
+                ptr = telemtrySendFloat(ptr, ukf.x[UKF_STATE_VELE]);
                 ptr = telemtrySendFloat(ptr, -VELOCITYD);
-                ptr = telemtrySendFloat(ptr, IMU_MAGX);
-                ptr = telemtrySendFloat(ptr, IMU_MAGY);
-                ptr = telemtrySendFloat(ptr, IMU_MAGZ);
-                ptr = telemtrySendInt(ptr, 1e6 / (IMU_LASTUPD - lastAqUpdate));
+                ptr = telemtrySendFloat(ptr, imu.mag[0]);
+                ptr = telemtrySendFloat(ptr, imu.mag[1]);
+                ptr = telemtrySendFloat(ptr, imu.mag[2]);
+                ptr = telemtrySendInt(ptr, 1e6 / (imu.lastUpdate - lastAqUpdate));
                 ptr = telemtrySendFloat(ptr, RADIO_QUALITY);
                 ptr = telemtrySendFloat(ptr, motorsData.value[0]);
                 ptr = telemtrySendFloat(ptr, motorsData.value[1]);
                 ptr = telemtrySendFloat(ptr, motorsData.value[2]);
                 ptr = telemtrySendFloat(ptr, motorsData.value[3]);
                 ptr = telemtrySendFloat(ptr, supervisorData.idlePercent);
-                ptr = telemtrySendFloat(ptr, UKF_ACC_BIAS_X);
-                ptr = telemtrySendFloat(ptr, UKF_ACC_BIAS_Y);
-                ptr = telemtrySendFloat(ptr, UKF_ACC_BIAS_Z);
+                ptr = telemtrySendFloat(ptr, ukf.x[UKF_STATE_ACC_BIAS_X]);
+                ptr = telemtrySendFloat(ptr, ukf.x[UKF_STATE_ACC_BIAS_Y]);
+                ptr = telemtrySendFloat(ptr, ukf.x[UKF_STATE_ACC_BIAS_Z]);
                 //ptr = telemtrySendFloat(ptr, supervisorData.flightTimeRemaining);
 
                 *ptr++ = telemetryData.ckA;
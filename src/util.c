@@ -71,6 +71,82 @@ uint16_t utilGetStackFree(const char *stackName) {
 
 #endif
 
+#ifdef UTIL_TASK_STATS
+utilTaskStatsStruct_t utilTaskStatsData CCM_RAM;
+
+// called from the scheduler right before a context switch, keep it short
+void utilTaskSwitch(uint8_t curTaskId, uint8_t nextTaskId) {
+    utilTaskStats_t *t;
+    uint32_t now, run;
+
+    now = timerMicros();
+
+    if (curTaskId < UTIL_TASK_STATS) {
+        t = &utilTaskStatsData.tasks[curTaskId];
+        run = now - utilTaskStatsData.switchTime;
+        t->runTime += run;
+        if (run > t->maxRun)
+            t->maxRun = run;
+    }
+
+    if (nextTaskId < UTIL_TASK_STATS) {
+        t = &utilTaskStatsData.tasks[nextTaskId];
+        t->activations++;
+        if (t->readyPending) {
+            run = now - t->readyTime;
+            if (run > t->maxLatency)
+                t->maxLatency = run;
+            t->readyPending = 0;
+        }
+    }
+
+    utilTaskStatsData.switchTime = now;
+}
+
+// task put into the ready list, keep the earliest time if it is requeued
+void utilTaskReady(uint8_t taskId) {
+    utilTaskStats_t *t;
+
+    if (taskId < UTIL_TASK_STATS) {
+        t = &utilTaskStatsData.tasks[taskId];
+        if (!t->readyPending) {
+            t->readyTime = timerMicros();
+            t->readyPending = 1;
+        }
+    }
+}
+
+// calculate CPU share of each task since last call
+void utilTaskStatsUpdate(void) {
+    utilTaskStats_t *t;
+    uint32_t now, period, runTime;
+    int i;
+
+    now = timerMicros();
+    period = now - utilTaskStatsData.lastUpdate;
+    utilTaskStatsData.lastUpdate = now;
+
+    if (!period)
+        return;
+
+    for (i = 0; i < UTIL_TASK_STATS; i++) {
+        t = &utilTaskStatsData.tasks[i];
+        runTime = t->runTime;
+        t->cpuPercent = (runTime - t->lastRunTime) * 100.0f / period;
+        t->lastRunTime = runTime;
+    }
+}
+
+void utilTaskStatsResetMax(void) {
+    int i;
+
+    for (i = 0; i < UTIL_TASK_STATS; i++) {
+        utilTaskStatsData.tasks[i].maxRun = 0;
+        utilTaskStatsData.tasks[i].maxLatency = 0;
+    }
+}
+#endif
+
 void *aqCalloc(size_t count, size_t size) {
     char *addr = 0;
 
@@ -204,6 +280,45 @@ float utilFilter3(utilFilter_t *f, float signal) {
     return utilFilter(&f[0], utilFilter(&f[1], utilFilter(&f[2], signal)));
 }
 
+// RBJ notch, a zero, negative or above Nyquist frequency leaves the signal untouched
+void utilBiquadNotch(utilBiquadCoef_t *c, float dt, float freq, float q) {
+    float w, alpha, a0;
+
+    if (freq <= 0.0f || freq >= 0.5f / dt || q <= 0.0f) {
+        c->b0 = 1.0f;
+        c->b1 = 0.0f;
+        c->b2 = 0.0f;
+        c->a1 = 0.0f;
+        c->a2 = 0.0f;
+    }
+    else {
+        w = 2.0f * M_PI * freq * dt;
+        alpha = sinf(w) / (2.0f * q);
+        a0 = 1.0f / (1.0f + alpha);
+
+        c->b0 = a0;
+        c->b1 = -2.0f * cosf(w) * a0;
+        c->b2 = a0;
+        c->a1 = c->b1;
+        c->a2 = (1.0f - alpha) * a0;
+    }
+}
+
+void utilBiquadReset(utilBiquad_t *f) {
+    f->z1 = 0.0f;
+    f->z2 = 0.0f;
+}
+
+float utilBiquad(utilBiquad_t *f, float signal) {
+    register float out;
+
+    out = f->c.b0 * signal + f->z1;
+    f->z1 = f->c.b1 * signal - f->c.a1 * out + f->z2;
+    f->z2 = f->c.b2 * signal - f->c.a2 * out;
+
+    return out;
+}
+
 float utilFirFilter(utilFirFilter_t *f, float newValue) {
     float result = 0.0f;
     int i;
@@ -228,3 +343,109 @@ void utilFirFilterInit(utilFirFilter_t *f, const float *window, float *buffer, u
     for (i = 0; i < n; i++)
         f->data[i] = 0.0f;
 }
+
+void utilRunStatInit(utilRunStat_t *s, float *buffer, uint16_t n) {
+    s->data = buffer;
+    s->n = n;
+    s->i = 0;
+    s->count = 0;
+    s->mean = 0.0f;
+    s->m2 = 0.0f;
+}
+
+// start with a full window of constant samples
+void utilRunStatFill(utilRunStat_t *s, float value) {
+    int i;
+
+    for (i = 0; i < s->n; i++)
+        s->data[i] = value;
+
+    s->i = 0;
+    s->count = s->n;
+    s->mean = value;
+    s->m2 = 0.0f;
+}
+
+// Welford update, once the window is full the oldest sample is swapped out in the same step
+void utilRunStat(utilRunStat_t *s, float value) {
+    float old, delta, mean;
+    int i;
+
+    if (s->count < s->n) {
+        s->count++;
+        delta = value - s->mean;
+        s->mean += delta / s->count;
+        s->m2 += delta * (value - s->mean);
+    }
+    else {
+        old = s->data[s->i];
+        mean = s->mean + (value - old) / s->n;
+        s->m2 += (value - old) * (value - mean + old - s->mean);
+        s->mean = mean;
+    }
+
+    s->data[s->i] = value;
+
+    if (++s->i == s->n) {
+        s->i = 0;
+
+        // re-sum once per window so rounding cannot accumulate
+        mean = 0.0f;
+        for (i = 0; i < s->count; i++)
+            mean += s->data[i];
+        mean /= s->count;
+
+        s->m2 = 0.0f;
+        for (i = 0; i < s->count; i++) {
+            delta = s->data[i] - mean;
+            s->m2 += delta * delta;
+        }
+        s->mean = mean;
+    }
+
+    if (s->m2 < 0.0f)
+        s->m2 = 0.0f;
+}
+
+// sample standard deviation, same as arm_std_f32() over the window
+float utilRunStatStd(utilRunStat_t *s) {
+    if (s->count < 2)
+        return 0.0f;
+    else
+        return __sqrtf(s->m2 / (s->count - 1));
+}
+
+void utilSeqLatchInit(utilSeqLatch_t *l, void *copy0, void *copy1, uint16_t size) {
+    l->seq = 0;
+    l->copy[0] = copy0;
+    l->copy[1] = copy1;
+    l->size = size;
+}
+
+// single writer only
+void utilSeqPublish(utilSeqLatch_t *l, const void *data) {
+    // odd - readers use copy[1] while copy[0] is updated
+    l->seq++;
+    __DMB();
+    memcpy(l->copy[0], data, l->size);
+    __DMB();
+
+    // even - readers use copy[0] while copy[1] is updated
+    l->seq++;
+    __DMB();
+    memcpy(l->copy[1], data, l->size);
+    __DMB();
+}
+
+// a reader which preempts the writer always finds a stable copy and returns
+// on the first pass, a lower priority reader retries if the writer ran meanwhile
+void utilSeqRead(utilSeqLatch_t *l, void *data) {
+    uint32_t seq;
+
+    do {
+        seq = l->seq;
+        __DMB();
+        memcpy(data, l->copy[seq & 1], l->size);
+        __DMB();
+    } while (seq != l->seq);
+}
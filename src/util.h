@@ -24,6 +24,9 @@
 #include <stdlib.h>
 
 #define UTIL_STACK_CHECK     CFG_MAX_USER_TASKS  // uncomment to allow system to self check for stack overflows
+#if CFG_TASK_SWITCH_HOOK_EN
+#define UTIL_TASK_STATS      (CFG_MAX_USER_TASKS+1)  // per-task CPU accounting, user tasks + idle task
+#endif
 
 #define UTIL_CCM_HEAP_SIZE     (0x2800) // 40KB
 
@@ -44,6 +47,17 @@ typedef struct {
     float z1;
 } utilFilter_t;
 
+// biquad section, direct form II transposed
+typedef struct {
+    float b0, b1, b2;
+    float a1, a2;
+} utilBiquadCoef_t;
+
+typedef struct {
+    utilBiquadCoef_t c;
+    float z1, z2;
+} utilBiquad_t;
+
 typedef struct {
     const float *window;
     float *data;
@@ -51,6 +65,45 @@ typedef struct {
     uint8_t i;
 } utilFirFilter_t;
 
+// running mean & variance over a sliding window of the last n samples
+typedef struct {
+    float *data;
+    float mean;
+    float m2;           // sum of squared deviations from the mean
+    uint16_t n;
+    uint16_t i;
+    uint16_t count;     // samples in the window, up to n
+} utilRunStat_t;
+
+// sequence latch - one writer publishes into two copies, readers never block
+// the writer and can preempt it at any point without seeing a torn copy
+typedef struct {
+    volatile uint32_t seq;
+    void *copy[2];
+    uint16_t size;
+} utilSeqLatch_t;
+
+#ifdef UTIL_TASK_STATS
+typedef struct {
+    uint32_t runTime;       // cumulative run time (us)
+    uint32_t activations;   // number of times task was switched in
+    uint32_t maxRun;        // longest continuous run (us)
+    uint32_t maxLatency;    // worst case delay from ready to running (us)
+    uint32_t readyTime;     // when task last became ready
+    uint32_t lastRunTime;   // runTime at last utilTaskStatsUpdate()
+    float cpuPercent;       // CPU share over last update period
+    uint8_t readyPending;
+} utilTaskStats_t;
+
+typedef struct {
+    utilTaskStats_t tasks[UTIL_TASK_STATS];
+    uint32_t switchTime;    // time of last context switch
+    uint32_t lastUpdate;
+} utilTaskStatsStruct_t;
+
+extern utilTaskStatsStruct_t utilTaskStatsData;
+#endif
+
 extern uint32_t heapUsed, heapHighWater, dataSramUsed;
 
 extern void delay(unsigned long t);
@@ -70,13 +123,29 @@ extern void utilFilterReset(utilFilter_t *f, float setpoint);
 extern void utilFilterReset3(utilFilter_t *f, float setpoint);
 extern void utilSerialNoString(void);
 extern void utilVersionString(void);
+extern void utilBiquadNotch(utilBiquadCoef_t *c, float dt, float freq, float q);
+extern void utilBiquadReset(utilBiquad_t *f);
+extern float utilBiquad(utilBiquad_t *f, float signal);
 extern float utilFirFilter(utilFirFilter_t *f, float newValue);
 extern void utilFirFilterInit(utilFirFilter_t *f, const float *window, float *buffer, uint8_t n);
+extern void utilRunStatInit(utilRunStat_t *s, float *buffer, uint16_t n);
+extern void utilRunStatFill(utilRunStat_t *s, float value);
+extern void utilRunStat(utilRunStat_t *s, float value);
+extern float utilRunStatStd(utilRunStat_t *s);
+extern void utilSeqLatchInit(utilSeqLatch_t *l, void *copy0, void *copy1, uint16_t size);
+extern void utilSeqPublish(utilSeqLatch_t *l, const void *data);
+extern void utilSeqRead(utilSeqLatch_t *l, void *data);
 #ifdef UTIL_STACK_CHECK
 extern void utilStackCheck(void);
 extern uint16_t stackFrees[UTIL_STACK_CHECK];
 extern uint16_t utilGetStackFree(const char *stackName);
 #endif
+#ifdef UTIL_TASK_STATS
+extern void utilTaskSwitch(uint8_t curTaskId, uint8_t nextTaskId);
+extern void utilTaskReady(uint8_t taskId);
+extern void utilTaskStatsUpdate(void);
+extern void utilTaskStatsResetMax(void);
+#endif
 //extern int ftoa(char *buf, float f, unsigned int digits);
 
 #endif
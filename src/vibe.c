@@ -0,0 +1,255 @@
+/*
+    This file is part of AutoQuad.
+
+    AutoQuad is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AutoQuad is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with AutoQuad.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright (c) 2011-2014  Bill Nesbitt
+*/
+
+#include "aq.h"
+#include "vibe.h"
+#include "config.h"
+#include "util.h"
+#include "comm.h"
+#include "arm_math.h"
+#include "arm_const_structs.h"
+#include <string.h>
+#include <math.h>
+
+vibeStruct_t vibeData CCM_RAM;
+
+#ifdef HAS_VIBE
+#include "d_imu.h"
+
+#if VIBE_N != 256
+#error "vibeInit() sets up the FFT for 256 samples"
+#endif
+
+OS_STK *vibeTaskStack;
+
+// band edges in bins of VIBE_RATE / VIBE_N Hz
+static const uint8_t vibeBandEdges[VIBE_BANDS+1] = {
+    2, 3, 4, 6, 8, 11, 16, 22, 32, 45, 64, 90, VIBE_N/2
+};
+
+// called from the sensor's SPI completion with acc x, y, z, gyo x, y, z raw counts
+void vibeSample(int16_t *s) {
+    int i;
+
+    for (i = 0; i < VIBE_CHANNELS; i++)
+        vibeData.sum[i] += s[i];
+
+    if (++vibeData.decim == VIBE_DECIMATE) {
+        vibeData.decim = 0;
+
+        for (i = 0; i < VIBE_CHANNELS; i++) {
+            vibeData.buf[i*VIBE_N + vibeData.n] = vibeData.sum[i] / VIBE_DECIMATE;
+            vibeData.sum[i] = 0;
+        }
+
+        if (++vibeData.n == VIBE_N)
+            vibeData.capture = 0;
+    }
+}
+
+static void vibeAnalyze(int ch, vibeChannel_t *r) {
+    int16_t *x = &vibeData.buf[ch*VIBE_N];
+    float *in = vibeData.in;
+    float *out = vibeData.out;
+    float scale, mean, rms, w;
+    float a, b, c, d;
+    int i, j, k;
+
+    if (ch < 3)
+        scale = 1.0f / ((1<<16) / (MPU6000_ACC_SCALE * 2.0f)) * GRAVITY;
+    else
+        scale = 1.0f / ((1<<16) / (MPU6000_GYO_SCALE * 2.0f)) * DEG_TO_RAD;
+
+    mean = 0.0f;
+    for (i = 0; i < VIBE_N; i++)
+        mean += x[i];
+    mean /= VIBE_N;
+
+    // remove DC, Hann window
+    rms = 0.0f;
+    for (i = 0; i < VIBE_N; i++) {
+        a = (x[i] - mean) * scale;
+        rms += a*a;
+
+        w = 0.5f - 0.5f * cosf(2.0f * M_PI * i / VIBE_N);
+        in[i] = a * w;
+    }
+    r->rms = __sqrtf(rms / VIBE_N);
+
+    arm_rfft_fast_f32(&vibeData.rfft, in, out, 0);
+
+    // power per bin, input buffer is free again
+    in[0] = 0.0f;
+    for (k = 1; k < VIBE_N/2; k++)
+        in[k] = out[k*2]*out[k*2] + out[k*2+1]*out[k*2+1];
+
+    // band rms, Hann noise gain is 3/8
+    for (i = 0; i < VIBE_BANDS; i++) {
+        a = 0.0f;
+        for (k = vibeBandEdges[i]; k < vibeBandEdges[i+1]; k++)
+            a += in[k];
+        r->band[i] = __sqrtf(a * 2.0f / (VIBE_N * VIBE_N * 0.375f));
+    }
+
+    for (j = 0; j < VIBE_PEAKS; j++) {
+        r->freq[j] = 0.0f;
+        r->amp[j] = 0.0f;
+    }
+
+    // strongest local maxima
+    for (k = VIBE_MIN_BIN; k < VIBE_N/2 - 1; k++) {
+        if (in[k] > in[k-1] && in[k] >= in[k+1]) {
+            a = __sqrtf(in[k-1]);
+            b = __sqrtf(in[k]);
+            c = __sqrtf(in[k+1]);
+
+            // parabolic interpolation of the peak position
+            d = a - 2.0f * b + c;
+            d = (d != 0.0f) ? 0.5f * (a - c) / d : 0.0f;
+
+            // a sine of amplitude A shows as A * N / 4 through the Hann window
+            b *= 4.0f / VIBE_N;
+            if (b <= r->amp[VIBE_PEAKS-1])
+                continue;
+
+            for (j = VIBE_PEAKS-1; j > 0 && b > r->amp[j-1]; j--) {
+                r->freq[j] = r->freq[j-1];
+                r->amp[j] = r->amp[j-1];
+            }
+            r->freq[j] = (k + d) * (VIBE_RATE / VIBE_N);
+            r->amp[j] = b;
+        }
+    }
+}
+
+// move the dynamic gyo notch to the strongest gyo peak, as seen by the inner loop
+static void vibeTrackNotch(void) {
+    float fs = 1.0f / DIMU_INNER_DT;
+    float f;
+
+    if (p[IMU_DYN_NOTCH] <= 0.0f) {
+        if (vibeData.dynNotch != 0.0f) {
+            vibeData.dynNotch = 0.0f;
+            dIMUSetDynamicNotch(0.0f);
+        }
+        return;
+    }
+
+    if (vibeData.gyoFreq < p[IMU_DYN_NOTCH])
+        return;
+
+    if (vibeData.dynNotch == 0.0f)
+        vibeData.dynNotch = vibeData.gyoFreq;
+    else
+        vibeData.dynNotch += (vibeData.gyoFreq - vibeData.dynNotch) * VIBE_DYN_TAU;
+
+    // rates are decimated to the inner loop, so vibration above its Nyquist folds down
+    f = fmodf(vibeData.dynNotch, fs);
+    if (f > fs * 0.5f)
+        f = fs - f;
+
+    dIMUSetDynamicNotch(f);
+}
+
+static void vibeTaskCode(void *unused) {
+    vibeChannel_t r;
+    float gyoRms, accRms;
+    int i;
+
+    AQ_NOTICE("Vibe task started\n");
+
+    while (1) {
+        yield(VIBE_PERIOD);
+
+        vibeData.n = 0;
+        vibeData.decim = 0;
+        for (i = 0; i < VIBE_CHANNELS; i++)
+            vibeData.sum[i] = 0;
+        vibeData.capture = 1;
+
+        while (vibeData.capture)
+            yield(10);
+
+        vibeData.gyoAmp = 0.0f;
+        vibeData.accAmp = 0.0f;
+        gyoRms = 0.0f;
+        accRms = 0.0f;
+
+        for (i = 0; i < VIBE_CHANNELS; i++) {
+            vibeAnalyze(i, &r);
+            utilSeqPublish(&vibeData.latch[i], &r);
+
+            if (i < 3) {
+                accRms += r.rms * r.rms;
+                if (r.amp[0] > vibeData.accAmp) {
+                    vibeData.accAmp = r.amp[0];
+                    vibeData.accFreq = r.freq[0];
+                }
+            }
+            else {
+                gyoRms += r.rms * r.rms;
+                if (r.amp[0] > vibeData.gyoAmp) {
+                    vibeData.gyoAmp = r.amp[0];
+                    vibeData.gyoFreq = r.freq[0];
+                }
+            }
+        }
+
+        vibeData.accRms = __sqrtf(accRms);
+        vibeData.gyoRms = __sqrtf(gyoRms);
+        vibeData.windows++;
+
+        vibeTrackNotch();
+    }
+}
+
+void vibeGetChannel(int ch, vibeChannel_t *c) {
+    utilSeqRead(&vibeData.latch[ch], c);
+}
+
+void vibeInit(void) {
+    int i;
+
+    memset((void *)&vibeData, 0, sizeof(vibeData));
+
+    for (i = 0; i < VIBE_CHANNELS; i++)
+        utilSeqLatchInit(&vibeData.latch[i], &vibeData.chan[i][0], &vibeData.chan[i][1], sizeof(vibeChannel_t));
+
+    vibeData.buf = (int16_t *)aqDataCalloc(VIBE_CHANNELS*VIBE_N, sizeof(int16_t));
+    vibeData.in = (float *)aqDataCalloc(VIBE_N, sizeof(float));
+    vibeData.out = (float *)aqDataCalloc(VIBE_N, sizeof(float));
+
+    // the bundled arm_rfft_fast_init_f32() does not set the twiddle tables and would
+    // pull in every table size, so the instance for VIBE_N is filled in directly
+    vibeData.rfft.Sint = arm_cfft_sR_f32_len128;
+    vibeData.rfft.fftLenRFFT = VIBE_N;
+    vibeData.rfft.pTwiddleRFFT = (float32_t *)twiddleCoef_rfft_256;
+
+    vibeTaskStack = aqStackInit(VIBE_STACK_SIZE, "VIBE");
+
+    vibeData.task = CoCreateTask(vibeTaskCode, (void *)0, VIBE_PRIORITY, &vibeTaskStack[VIBE_STACK_SIZE-1], VIBE_STACK_SIZE);
+}
+#else
+void vibeInit(void) {
+    memset((void *)&vibeData, 0, sizeof(vibeData));
+}
+
+void vibeGetChannel(int ch, vibeChannel_t *c) {
+    memset(c, 0, sizeof(vibeChannel_t));
+}
+#endif
@@ -0,0 +1,83 @@
+/*
+    This file is part of AutoQuad.
+
+    AutoQuad is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AutoQuad is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with AutoQuad.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright (c) 2011-2014  Bill Nesbitt
+*/
+
+#ifndef _vibe_h
+#define _vibe_h
+
+#include "aq.h"
+#include "util.h"
+#include "arm_math.h"
+#include <CoOS.h>
+
+#if defined(HAS_DIGITAL_IMU) && defined(DIMU_HAVE_MPU6000)
+#define HAS_VIBE
+#endif
+
+#define VIBE_STACK_SIZE     256     // must be evenly divisible by 8
+#define VIBE_PRIORITY       61
+#define VIBE_PERIOD         500     // ms between analysis windows
+
+#define VIBE_DECIMATE       4       // 8 kHz sensor samples averaged down to 2 kHz
+#define VIBE_RATE           (8000.0f / VIBE_DECIMATE)
+#define VIBE_N              256     // samples per window (128ms, 7.8Hz bins)
+#define VIBE_CHANNELS       6       // acc x, y, z, gyo x, y, z in sensor axes
+#define VIBE_PEAKS          3
+#define VIBE_BANDS          12      // compressed spectrum, log spaced bands
+#define VIBE_MIN_BIN        2       // ignore DC and the first bin
+
+#define VIBE_DYN_TAU        0.3f    // dynamic notch frequency smoothing factor per window
+
+// analysis of one channel over one window
+typedef struct {
+    float freq[VIBE_PEAKS];     // Hz, strongest first
+    float amp[VIBE_PEAKS];      // peak amplitude (rad/s or m/s^2)
+    float rms;                  // total AC rms of the window
+    float band[VIBE_BANDS];     // rms per band
+} vibeChannel_t;
+
+typedef struct {
+    OS_TID task;
+
+    int16_t *buf;               // [VIBE_CHANNELS][VIBE_N] capture
+    float *in;                  // FFT input, windowed
+    float *out;                 // FFT output, packed complex
+    int32_t sum[VIBE_CHANNELS];
+    volatile uint16_t n;
+    uint8_t decim;
+    volatile uint8_t capture;   // set by the task, cleared by the sampler when the window is full
+
+    arm_rfft_fast_instance_f32 rfft;
+
+    vibeChannel_t chan[VIBE_CHANNELS][2];
+    utilSeqLatch_t latch[VIBE_CHANNELS];
+
+    // strongest peaks for logging
+    float gyoFreq, gyoAmp, gyoRms;
+    float accFreq, accAmp, accRms;
+
+    float dynNotch;
+    uint32_t windows;
+} vibeStruct_t;
+
+extern vibeStruct_t vibeData;
+
+extern void vibeInit(void);
+extern void vibeSample(int16_t *s);
+extern void vibeGetChannel(int ch, vibeChannel_t *c);
+
+#endif